@@ -25,7 +25,11 @@ any lines above THIS line.
 #include <stdlib.h>
 #include <cstring>
 #include "m2g.h"
+#if defined(ARDUINO)
 #include <arduino.h>
+#else
+#include "tools/host.h"  // host build, see tools/replay.cpp
+#endif
 
 // morse code functions
 
@@ -147,6 +151,56 @@ inline int mcodes:: getcode(long key, char *val){
         return -1;
 }
 
+// cost of each letter's frequency, -ln(p) in 1/8 nats, for A - Z.
+// other characters cost PRIOROTHER
+const unsigned char lprior[26] = {
+  21, 34, 29, 26, 17, 31, 32, 23, 22, 53, 39, 27, 31,
+  22, 22, 33, 56, 23, 23, 20, 29, 38, 31, 53, 32, 59
+};
+#define PRIOROTHER 55
+
+// cost of a press of ms for an element whose average is mu: the negative
+// log of a Gaussian in log time (press times vary in proportion to their
+// length) with sd 1 / VSIGMA, in 1/8 nats. ln(ms / mu) is taken as
+// 2 (ms - mu) / (ms + mu), which is close enough and needs no log.
+// That is within +-2, so z is within +-8 * VSIGMA and needs no clamp
+inline long vcost(unsigned ms, unsigned mu) {
+  long z = ((long) ms - mu) * 8 * VSIGMA / ((long) ms + mu);  // 4 * z
+
+  return z * z / 4;  // 8 * z^2 / 2
+}
+
+// most likely letter for n presses of dur ms, given the average dit and
+// dah: the code of that length with the least timing cost plus letter
+// frequency cost. All paths through the code tree end in the table, so
+// scoring the table entries is the Viterbi search; a code is dropped as
+// soon as its cost passes the best so far.
+// returns the cost, or -1 (and '?') if no code has n elements
+inline int mcodes:: decode(unsigned *dur, int n, unsigned mdit, unsigned mdah, char *val){ 
+    long key, cost, best = -1;
+    int i, j, len;
+    char c;
+
+    *val = '?';
+    for (i = 0; i < cnt; i++) {
+        for (len = 0, key = mkey[i]; key > 0; key /= 10)
+            len++;
+        if (len != n)
+            continue;
+
+        c = toupper(mval[i]);
+        cost = (c >= 'A' && c <= 'Z') ? lprior[c - 'A'] : PRIOROTHER;
+        for (j = n - 1, key = mkey[i]; j >= 0 && (best < 0 || cost < best); j--, key /= 10)
+            cost += vcost(dur[j], key % 10 == 1 ? mdit : mdah);
+
+        if (j < 0 && (best < 0 || cost < best)) {
+            best = cost;
+            *val = mval[i];
+        }
+    }
+    return best;
+}
+
 inline int mcodes:: dumpcodes(char *str){
    char buf[100];
   
@@ -409,6 +463,78 @@ inline int pcodes::clear(){
 }
 
 
+// replace the top of the stack (push if empty)
+inline int pcodes::settop(unsigned v[]){ 
+  if (cnt == 0)
+    return push(v);
+  pdo[cnt-1] = v[0];
+  pda[cnt-1] = v[1];  
+  plt[cnt-1] = v[2];  
+  pcl[cnt-1] = v[3];
+  return cnt;
+}
+
+// ---------------- adaptive timing ------------------
+
+inline mtiming::mtiming() {
+  seed(MSDO, MSDA, MSLT);
+}
+
+// start the averages where the set thresholds put them: a dit half and a
+// dah 1.5 times the dit/dah border (the usual 1:3), gaps as long as a dit
+inline int mtiming::seed(unsigned ms_do, unsigned ms_da, unsigned ms_lt) {
+  bdo = ms_do;
+  bda = ms_da;
+  blt = ms_lt;
+  dit = (long) ms_do * 8;
+  dah = (long) ms_do * 24;
+  gap = dit;
+  return 0;
+}
+
+// take a dit or dah press into the nearer average
+inline int mtiming::press(unsigned ms) {
+  long x = (long) ms * 16;
+
+  if (x < (dit + dah) / 2) {
+    dit += (x - dit) >> ADAPTSH;
+    return 1;
+  }
+  dah += (x - dah) >> ADAPTSH;
+  return 2;
+}
+
+inline int mtiming::space(unsigned ms) {
+  gap += ((long) ms * 16 - gap) >> ADAPTSH;
+  return 0;
+}
+
+// keep a threshold within the limits chk_parm allows
+inline unsigned tclamp(long v) {
+  return v < 20 ? 20 : (v > 10000 ? 10000 : v);
+}
+
+inline unsigned mtiming::t_do() {
+  return tclamp((dit + dah) / 32);
+}
+
+// the set ratio to the dit/dah border, but well clear of the dahs and
+// of the gaps within a letter
+inline unsigned mtiming::t_da() {
+  long v = (long) bda * t_do() / bdo;
+
+  if (v < (2 * dah - dit) / 16)
+    v = (2 * dah - dit) / 16;
+  if (v < 3 * gap / 16)
+    v = 3 * gap / 16;
+  return tclamp(v);
+}
+
+// the set ratio to the end of letter
+inline unsigned mtiming::t_lt() {
+  return tclamp((long) blt * t_da() / bda);
+}
+
 // ---------------- character functions ------------------
 
 inline char_stk::char_stk() {
@@ -426,6 +552,12 @@ inline int char_stk::push(int c) {
     ditdah[ptr++] = c;    
 }
 
+inline int char_stk::push(int c, unsigned ms) {
+  if (ptr < MAXDD)
+    dur[ptr] = ms;
+  return push(c);
+}
+
 inline int char_stk::pop() {
   if (ptr >= 0) {
     ditdah[ptr] = 0;
@@ -41,6 +41,11 @@ any lines above THIS line.
 #define MSDA 1000
 #define MSLT 2000
 #define MSCL 5000
+#define ADAPT 1  // 1 - one button timing follows the user's speed, see mtiming
+#define ADAPTSH 3  // running averages move 1/8 of the way to each new time
+#define ADAPTSAVE 5  // % drift before adapted timing is saved to usr_parm.csv
+#define VITERBI 1  // 1 - one button letters are decoded from their press times, see mcodes::decode
+#define VSIGMA 4  // press times vary by about 1/VSIGMA of their average
 #define CODE "CODE.CSV"
 #define USR_PARM "USR_PARM.CSV"
 #define HELLO_FILE "HELLO.TXT"
@@ -60,6 +65,7 @@ class mcodes {
 	int loadcode(char*);
 	int sortcode();
 	int getcode(long, char *);
+	int decode(unsigned *, int, unsigned, unsigned, char *); // most likely letter
         int dumpcodes (char *); // for testing
         
         private:
@@ -91,16 +97,37 @@ class pcodes {
         int loadparmcode(char *);
 	int getcode_pop(int, unsigned[]);
         int push(unsigned[]);
+        int settop(unsigned[]);
         int clear();
 };
 
+// adaptive one button timing -- running averages of the user's dit and
+// dah press times (2 cluster online k-means) and of the gap between presses
+// within a letter, in ms * 16. The thresholds are derived from them:
+// the dit/dah border is halfway between the averages, and the letter and
+// word gaps scale with it from the user's set values
+class mtiming {
+	public:
+	long dit, dah, gap;
+	unsigned bdo, bda, blt;  // set thresholds, see seed
+        mtiming();
+	int seed(unsigned, unsigned, unsigned); // start from set do, da, lt
+	int press(unsigned); // a press in ms, returns 1 dit, 2 dah
+	int space(unsigned); // a gap within a letter in ms
+	unsigned t_do(); // dit/dah border
+	unsigned t_da(); // longest dah, end of letter
+	unsigned t_lt(); // end of word
+};
+
 // char class - stack of dits and dahs
 class char_stk {
   public:
     int ditdah[MAXDD]; // stack of dit and dahs
+    unsigned dur[MAXDD]; // and how long each was pressed, ms (one button)
     int ptr; // pointer to top of ditdah stack
     char_stk();
     int push(int); // push a ditdah  
+    int push(int, unsigned); // push a ditdah and its press time
     int pop(); // pop last ditdah
     int clear(); // clear stack
     long get_charval(); // get character value, eg, 12 or 2121
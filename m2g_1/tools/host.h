@@ -0,0 +1,30 @@
+/* host.h -- lets m2g.cpp build on a PC for the tools in this directory.
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative 
+Commons Attribution-ShareAlike 4.0 International License. For more information 
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/ 
+-- Basically, you can use this software for any purpose for free, 
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line. 
+*/
+
+#ifndef M2G_HOST_H
+#define M2G_HOST_H
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+// Serial messages from the classes go to stderr
+class HostSerial {
+  public:
+    void begin(long) {}
+    void print(const char *s) { fputs(s, stderr); }
+    void print(long v) { fprintf(stderr, "%ld", v); }
+    void println(const char *s) { fprintf(stderr, "%s\n", s); }
+    void println(long v) { fprintf(stderr, "%ld\n", v); }
+};
+static HostSerial Serial;
+
+#endif
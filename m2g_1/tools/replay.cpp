@@ -0,0 +1,160 @@
+/* replay.cpp -- replays one button press times through the timing, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative
+Commons Attribution-ShareAlike 4.0 International License. For more information
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/
+-- Basically, you can use this software for any purpose for free,
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line.
+
+Decodes a session of presses twice, with the fixed MSDO/MSDA thresholds and
+with mtiming (the sketch's own class from m2g.cpp) following the user the
+way loop() and adapt_timing do, and counts the letters each gets wrong.
+
+  build:  g++ -o replay tools/replay.cpp      (from the m2g_1 directory)
+  usage:  replay [session.txt]
+
+A session has one letter per line: the code that was meant, then the press
+and gap times in ms, a gap between each two presses of the letter, eg
+  -.-  420 130 150 110 390
+Lines starting with # are skipped. With no file, a made up session of 3000
+letters is used, whose dit slows from 110 to 260 ms as the user tires; the
+run then fails (exit 1) if the adaptive timing does worse than the fixed.
+*/
+
+#include "../m2g.cpp"
+
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+
+#define MAXLET 3000
+
+struct letter {
+  char code[MAXDD + 1];  // . dit, - dah
+  unsigned press[MAXDD];
+  unsigned gap[MAXDD];  // after each press but the last
+  int n;
+};
+
+static letter sess[MAXLET];
+static int nlet;
+
+static int readsess(const char *name) {
+  char line[200], *tok;
+  FILE *f;
+  letter *l;
+  int k;
+
+  if ((f = fopen(name, "r")) == NULL)
+    return -1;
+  while (nlet < MAXLET && fgets(line, sizeof(line), f)) {
+    if ((tok = strtok(line, " \t\r\n")) == NULL || tok[0] == '#')
+      continue;
+    l = &sess[nlet];
+    strncpy(l->code, tok, MAXDD);
+    l->n = strlen(l->code);
+    for (k = 0; k < 2 * l->n - 1 && (tok = strtok(NULL, " \t\r\n")); k++)
+      if (k & 1)
+        l->gap[k / 2] = atoi(tok);
+      else
+        l->press[k / 2] = atoi(tok);
+    if (k < 2 * l->n - 1) {
+      fprintf(stderr, "%s: letter %d is missing times\n", name, nlet + 1);
+      continue;
+    }
+    nlet++;
+  }
+  fclose(f);
+  return nlet;
+}
+
+// the made up session: random letters of 1 to MAXDD - 1 elements, dahs 3
+// dits long and gaps 1 dit long, each time off by about 18 %
+static void makesess() {
+  std::mt19937 rng(7);
+  std::lognormal_distribution<double> jit(0, 0.18);
+  double unit;
+  letter *l;
+  int k;
+
+  for (nlet = 0; nlet < MAXLET; nlet++) {
+    unit = 110 + 150.0 * nlet / MAXLET;
+    l = &sess[nlet];
+    l->n = 1 + rng() % (MAXDD - 1);
+    for (k = 0; k < l->n; k++) {
+      l->code[k] = rng() % 2 ? '-' : '.';
+      l->press[k] = unit * (l->code[k] == '-' ? 3 : 1) * jit(rng);
+      l->gap[k] = unit * jit(rng);
+    }
+    l->code[k] = 0;
+  }
+}
+
+// decode the session, returns the letters got wrong; from is the first
+// letter counted, so the later part of a session can be scored alone
+static int replay(int adaptive, int from, unsigned *ms_do, unsigned *ms_da) {
+  mtiming adapt;
+  letter *l;
+  int i, k, bad = 0, wrong;
+  char got;
+
+  *ms_do = MSDO;
+  *ms_da = MSDA;
+  adapt.seed(MSDO, MSDA, MSLT);
+  for (i = 0; i < nlet; i++) {
+    l = &sess[i];
+    wrong = 0;
+    for (k = 0; k < l->n; k++) {
+      if (k > 0) {
+        if (l->gap[k - 1] >= *ms_da)  // ended the letter early
+          wrong = 1;
+        else if (adaptive && l->gap[k - 1] > 0)
+          adapt.space(l->gap[k - 1]);
+      }
+      if (l->press[k] > 50 && l->press[k] < *ms_do)
+        got = '.';
+      else if (l->press[k] >= *ms_do && l->press[k] < *ms_da)
+        got = '-';
+      else
+        got = 0;  // not taken
+      if (got != l->code[k])
+        wrong = 1;
+      if (adaptive && l->press[k] > 50 && l->press[k] < *ms_da) {
+        adapt.press(l->press[k]);
+        *ms_do = adapt.t_do();
+        *ms_da = adapt.t_da();
+      }
+    }
+    if (i >= from)
+      bad += wrong;
+  }
+  return bad;
+}
+
+int main(int argc, char **argv) {
+  unsigned ms_do, ms_da;
+  int fixed, adaptive, fixlate, adlate, from;
+
+  if (argc > 1) {
+    if (readsess(argv[1]) <= 0) {
+      fprintf(stderr, "%s: no letters read\n", argv[1]);
+      return 2;
+    }
+  }
+  else
+    makesess();
+
+  from = nlet * 2 / 3;
+  fixed = replay(0, 0, &ms_do, &ms_da);
+  fixlate = replay(0, from, &ms_do, &ms_da);
+  printf("fixed:    %4d of %d letters wrong (%.1f%%), last third %.1f%%, do %u da %u\n",
+         fixed, nlet, 100.0 * fixed / nlet, 100.0 * fixlate / (nlet - from), ms_do, ms_da);
+  adaptive = replay(1, 0, &ms_do, &ms_da);
+  adlate = replay(1, from, &ms_do, &ms_da);
+  printf("adaptive: %4d of %d letters wrong (%.1f%%), last third %.1f%%, do %u da %u\n",
+         adaptive, nlet, 100.0 * adaptive / nlet, 100.0 * adlate / (nlet - from), ms_do, ms_da);
+
+  return argc == 1 && adaptive > fixed;
+}
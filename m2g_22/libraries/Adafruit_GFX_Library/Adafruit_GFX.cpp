@@ -56,6 +56,7 @@ Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h):
   textcolor = textbgcolor = 0xFFFF;
   wrap      = true;
   _cp437    = false;
+  textblit  = false;
 }
 
 // Draw a circle outline
@@ -242,6 +243,14 @@ void Adafruit_GFX::fillScreen(uint16_t color) {
   fillRect(0, 0, _width, _height, color);
 }
 
+// No address window by default, so drawChar draws pixel by pixel
+boolean Adafruit_GFX::openWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+  return false;
+}
+
+void Adafruit_GFX::pushWindow(const uint16_t *p, uint16_t n) {
+}
+
 // Draw a rounded rectangle
 void Adafruit_GFX::drawRoundRect(int16_t x, int16_t y, int16_t w,
   int16_t h, int16_t r, uint16_t color) {
@@ -445,6 +454,51 @@ void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
 
   if(!_cp437 && (c >= 176)) c++; // Handle 'classic' charset behavior
 
+  if (textblit) {
+    uint8_t glyph[5];
+    for (int8_t i=0; i<5; i++)
+      glyph[i] = pgm_read_byte(font+(c*5)+i);
+
+    if (bg != color) {
+      // Opaque: expand each font row into a scanline at the text size and
+      // send the whole 6x8 cell through one address window
+      if ((size <= BLITSIZE) && openWindow(x, y, 6 * size, 8 * size)) {
+        uint16_t line[6 * BLITSIZE];
+        for (int8_t j = 0; j<8; j++) {
+          for (int8_t i=0; i<6; i++) {
+            uint16_t px = (i < 5 && (glyph[i] & (1 << j))) ? color : bg;
+            for (uint8_t k = 0; k<size; k++)
+              line[i*size + k] = px;
+          }
+          for (uint8_t k = 0; k<size; k++)
+            pushWindow(line, 6 * size);
+        }
+        return;
+      }
+    } else {
+      // Transparent: the background must be left alone, so draw each
+      // vertical run of set pixels in a column as one rectangle
+      for (int8_t i=0; i<5; i++) {
+        uint8_t line = glyph[i];
+        for (int8_t j = 0; line; ) {
+          if (!(line & 0x1)) {
+            line >>= 1;
+            j++;
+            continue;
+          }
+          int8_t n = 0;
+          while (line & 0x1) {
+            line >>= 1;
+            n++;
+          }
+          fillRect(x+i*size, y+j*size, size, n*size, color);
+          j += n;
+        }
+      }
+      return;
+    }
+  }
+
   for (int8_t i=0; i<6; i++ ) {
     uint8_t line;
     if (i == 5) 
@@ -502,6 +556,13 @@ void Adafruit_GFX::setTextWrap(boolean w) {
   wrap = w;
 }
 
+// Draw text with as few address windows as the display allows (off by
+// default). Opaque text is sent a character cell at a time if the display
+// has openWindow; transparent text a run of pixels at a time.
+void Adafruit_GFX::setTextBlit(boolean b) {
+  textblit = b;
+}
+
 uint8_t Adafruit_GFX::getRotation(void) const {
   return rotation;
 }
@@ -10,6 +10,8 @@
 
 #define swap(a, b) { int16_t t = a; a = b; b = t; }
 
+#define BLITSIZE 4 // largest text size drawChar sends in one window
+
 class Adafruit_GFX : public Print {
 
  public:
@@ -30,6 +32,12 @@ class Adafruit_GFX : public Print {
     fillScreen(uint16_t color),
     invertDisplay(boolean i);
 
+  // A subclass that can stream pixels into an address window overrides
+  // these, so that drawChar can send a whole character cell at once.
+  // openWindow returns false if it can't (or the window is off screen).
+  virtual boolean openWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+  virtual void pushWindow(const uint16_t *p, uint16_t n);
+
   // These exist only with Adafruit_GFX (no subclass overrides)
   void
     drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color),
@@ -59,6 +67,7 @@ class Adafruit_GFX : public Print {
     setTextColor(uint16_t c, uint16_t bg),
     setTextSize(uint8_t s),
     setTextWrap(boolean w),
+    setTextBlit(boolean b),
     setRotation(uint8_t r),
     cp437(boolean x=true);
 
@@ -90,7 +99,8 @@ class Adafruit_GFX : public Print {
     rotation;
   boolean
     wrap,   // If set, 'wrap' text at right edge of display
-    _cp437; // If set, use correct CP437 charset (default is off)
+    _cp437, // If set, use correct CP437 charset (default is off)
+    textblit; // If set, drawChar sends each character in as few windows as it can
 };
 
 class Adafruit_GFX_Button {
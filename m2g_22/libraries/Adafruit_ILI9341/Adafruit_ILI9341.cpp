@@ -131,6 +131,138 @@ static inline void spi_end(void) {
 #define spi_end()
 #endif
 
+#if defined (__AVR__)
+// Wait for the byte being sent to finish, then start c. Callers work out
+// the next byte while the current one is still shifting out.
+static inline void spiput(uint8_t c) __attribute__((always_inline));
+static inline void spiput(uint8_t c) {
+  while(!(SPSR & _BV(SPIF)));
+  SPDR = c;
+}
+#endif
+
+// Send n pixels of one color as a single block of data. The bus is set
+// up once for the block instead of once per byte as in spiwrite().
+void Adafruit_ILI9341::spiColor(uint16_t color, uint32_t n) {
+  uint8_t hi = color >> 8, lo = color;
+
+  if (!n) return;
+  *dcport |=  dcpinmask;
+  *csport &= ~cspinmask;
+
+  if (hwSPI) {
+#if defined (__AVR__)
+    uint8_t backupSPCR = SPCR;
+    SPCR = mySPCR;
+    SPDR = hi;
+    while (--n) {
+      spiput(lo);
+      spiput(hi);
+    }
+    spiput(lo);
+    while(!(SPSR & _BV(SPIF)));
+    SPCR = backupSPCR;
+#elif defined(TEENSYDUINO)
+    while (n--) {
+      SPI.transfer(hi);
+      SPI.transfer(lo);
+    }
+#elif defined (__arm__)
+    SPI.setClockDivider(11); // 8-ish MHz (full! speed!)
+    SPI.setBitOrder(MSBFIRST);
+    SPI.setDataMode(SPI_MODE0);
+    while (n--) {
+      SPI.transfer(hi);
+      SPI.transfer(lo);
+    }
+#endif
+  } else {
+    while (n--) {
+      spiwrite(hi);
+      spiwrite(lo);
+    }
+  }
+
+  *csport |= cspinmask;
+}
+
+// Send the n pixels in p as a single block of data
+void Adafruit_ILI9341::spiPixels(const uint16_t *p, uint16_t n) {
+  uint16_t c;
+
+  if (!n) return;
+  *dcport |=  dcpinmask;
+  *csport &= ~cspinmask;
+
+  if (hwSPI) {
+#if defined (__AVR__)
+    uint8_t backupSPCR = SPCR;
+    SPCR = mySPCR;
+    c = *p++;
+    SPDR = c >> 8;
+    while (--n) {
+      spiput(c);
+      c = *p++;
+      spiput(c >> 8);
+    }
+    spiput(c);
+    while(!(SPSR & _BV(SPIF)));
+    SPCR = backupSPCR;
+#elif defined(TEENSYDUINO)
+    while (n--) {
+      c = *p++;
+      SPI.transfer(c >> 8);
+      SPI.transfer(c);
+    }
+#elif defined (__arm__)
+    SPI.setClockDivider(11); // 8-ish MHz (full! speed!)
+    SPI.setBitOrder(MSBFIRST);
+    SPI.setDataMode(SPI_MODE0);
+    while (n--) {
+      c = *p++;
+      SPI.transfer(c >> 8);
+      SPI.transfer(c);
+    }
+#endif
+  } else {
+    while (n--) {
+      c = *p++;
+      spiwrite(c >> 8);
+      spiwrite(c);
+    }
+  }
+
+  *csport |= cspinmask;
+}
+
+// Send n pixels of color to the window set by setAddrWindow(). Several
+// calls continue to fill the same window.
+void Adafruit_ILI9341::writeColor(uint16_t color, uint32_t n) {
+  if (hwSPI) spi_begin();
+  spiColor(color, n);
+  if (hwSPI) spi_end();
+}
+
+// Send the n pixels in p to the window set by setAddrWindow()
+void Adafruit_ILI9341::writePixels(const uint16_t *p, uint16_t n) {
+  if (hwSPI) spi_begin();
+  spiPixels(p, n);
+  if (hwSPI) spi_end();
+}
+
+// Address window for Adafruit_GFX::drawChar, only if it is all on screen
+boolean Adafruit_ILI9341::openWindow(int16_t x, int16_t y, int16_t w, int16_t h) {
+  if((x < 0) || (y < 0) || (x + w > _width) || (y + h > _height)) return false;
+  if (hwSPI) spi_begin();
+  setAddrWindow(x, y, x+w-1, y+h-1);
+  if (hwSPI) spi_end();
+  return true;
+}
+
+void Adafruit_ILI9341::pushWindow(const uint16_t *p, uint16_t n) {
+  writePixels(p, n);
+}
+
 // Rather than a bazillion writecommand() and writedata() calls, screen
 // initialization commands and arguments are organized in these tables
 // stored in PROGMEM.  The table may look bulky, but that's mostly the
@@ -366,18 +498,7 @@ void Adafruit_ILI9341::setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1,
 
 
 void Adafruit_ILI9341::pushColor(uint16_t color) {
-  if (hwSPI) spi_begin();
-  //digitalWrite(_dc, HIGH);
-  *dcport |=  dcpinmask;
-  //digitalWrite(_cs, LOW);
-  *csport &= ~cspinmask;
-
-  spiwrite(color >> 8);
-  spiwrite(color);
-
-  *csport |= cspinmask;
-  //digitalWrite(_cs, HIGH);
-  if (hwSPI) spi_end();
+  writePixels(&color, 1);
 }
 
 void Adafruit_ILI9341::drawPixel(int16_t x, int16_t y, uint16_t color) {
@@ -409,23 +530,11 @@ void Adafruit_ILI9341::drawFastVLine(int16_t x, int16_t y, int16_t h,
 
   if((y+h-1) >= _height) 
     h = _height-y;
+  if(h < 1) return;
 
   if (hwSPI) spi_begin();
   setAddrWindow(x, y, x, y+h-1);
-
-  uint8_t hi = color >> 8, lo = color;
-
-  *dcport |=  dcpinmask;
-  //digitalWrite(_dc, HIGH);
-  *csport &= ~cspinmask;
-  //digitalWrite(_cs, LOW);
-
-  while (h--) {
-    spiwrite(hi);
-    spiwrite(lo);
-  }
-  *csport |= cspinmask;
-  //digitalWrite(_cs, HIGH);
+  spiColor(color, h);
   if (hwSPI) spi_end();
 }
 
@@ -436,20 +545,10 @@ void Adafruit_ILI9341::drawFastHLine(int16_t x, int16_t y, int16_t w,
   // Rudimentary clipping
   if((x >= _width) || (y >= _height)) return;
   if((x+w-1) >= _width)  w = _width-x;
+  if(w < 1) return;
   if (hwSPI) spi_begin();
   setAddrWindow(x, y, x+w-1, y);
-
-  uint8_t hi = color >> 8, lo = color;
-  *dcport |=  dcpinmask;
-  *csport &= ~cspinmask;
-  //digitalWrite(_dc, HIGH);
-  //digitalWrite(_cs, LOW);
-  while (w--) {
-    spiwrite(hi);
-    spiwrite(lo);
-  }
-  *csport |= cspinmask;
-  //digitalWrite(_cs, HIGH);
+  spiColor(color, w);
   if (hwSPI) spi_end();
 }
 
@@ -465,25 +564,11 @@ void Adafruit_ILI9341::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
   if((x >= _width) || (y >= _height)) return;
   if((x + w - 1) >= _width)  w = _width  - x;
   if((y + h - 1) >= _height) h = _height - y;
+  if((w < 1) || (h < 1)) return;
 
   if (hwSPI) spi_begin();
   setAddrWindow(x, y, x+w-1, y+h-1);
-
-  uint8_t hi = color >> 8, lo = color;
-
-  *dcport |=  dcpinmask;
-  //digitalWrite(_dc, HIGH);
-  *csport &= ~cspinmask;
-  //digitalWrite(_cs, LOW);
-
-  for(y=h; y>0; y--) {
-    for(x=w; x>0; x--) {
-      spiwrite(hi);
-      spiwrite(lo);
-    }
-  }
-  //digitalWrite(_cs, HIGH);
-  *csport |= cspinmask;
+  spiColor(color, (uint32_t) w * h);
   if (hwSPI) spi_end();
 }
 
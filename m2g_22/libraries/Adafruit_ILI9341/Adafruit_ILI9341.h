@@ -129,7 +129,11 @@ class Adafruit_ILI9341 : public Adafruit_GFX {
            fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
              uint16_t color),
            setRotation(uint8_t r),
-           invertDisplay(boolean i);
+           invertDisplay(boolean i),
+           writeColor(uint16_t color, uint32_t n),
+           writePixels(const uint16_t *p, uint16_t n),
+           pushWindow(const uint16_t *p, uint16_t n);
+  boolean  openWindow(int16_t x, int16_t y, int16_t w, int16_t h);
   uint16_t color565(uint8_t r, uint8_t g, uint8_t b);
 
   /* These are not for current use, 8-bit protocol only! */
@@ -150,6 +154,9 @@ class Adafruit_ILI9341 : public Adafruit_GFX {
  private:
   uint8_t  tabcolor;
 
+  void     spiColor(uint16_t color, uint32_t n),
+           spiPixels(const uint16_t *p, uint16_t n);
+
 
 
   boolean  hwSPI;
@@ -24,31 +24,36 @@ any lines above THIS line.
 
 #include <stdlib.h>
 //#include <cstring.h>
-#include "m2g.h"
 //#include <arduino.h>
 
 #if defined(ARDUINO) && ARDUINO >= 100
 #include "Arduino.h"
-#else
+#elif defined(ARDUINO)
 #include "WProgram.h"
+#else
+#include "tools/host.h"  // host build, see tools/m2gc.cpp
 #endif
 
+#include "m2g.h"
+#include "m2g_codes.h"  // built-in code tables, generated from CODE.CSV
+
 
 // morse code functions
 
 // -----------  morse codes -----------------
 inline mcodes::mcodes() {
+  memset(mtab, 0, MTABSZ);
+  memset(mlive, 0, MTABSZ / 8);
   cnt = 0; 
 }
 
 inline int mcodes::loadcode(char* buf) { 
-	char * p;
 	char * p1;
 	char buf1[60];
 	char typcode[10];
 	char ktok[10];
 	char vtok[10];
-	long key;
+	int code;
 
         strcpy(buf1, buf);
 
@@ -56,107 +61,179 @@ inline int mcodes::loadcode(char* buf) {
 	strcpy(typcode, p1);  // type of code, eg, mcode
 
 	p1 = strtok(NULL, ",");
-	strcpy(ktok, p1);
-	key = strtol(ktok, NULL, 10);  // key of code, eg, 12, 2111 (a, b)
+	strcpy(ktok, p1);  // key of code, eg, 12, 2111 (a, b)
 	
 	p1 = strtok(NULL, ",");
 	strcpy(vtok, p1); // value of code, eg A, B
 
-	mkey[cnt] = key;  
-	mval[cnt] = vtok[0];
-	cnt++;
-}
+        code = packcode(ktok);
+        if (code < 0)
+            return -1;
 
-inline int mcodes::sortcode(){ 
+        if (!mtab[code])
+	    cnt++;
+	mtab[code] = vtok[0];
 
-   q_sort(mkey, mval, 0, cnt-1);
-  
+        // mark the code and its prefixes as live
+        for (int c = code; c > 0; c >>= 1)
+            mlive[c >> 3] |= 1 << (c & 7);
+	return code;
 }
 
-// quick sort - code copied from 
-// (http://) p2p.wrox.com/visual-c/66347-quick-sort-c-code.html 
+// convert a key from CODE.CSV (1 = dit, 2 = dah) to a packed code
+// returns -1 if the key is empty, too long or not made of 1s and 2s
+inline int mcodes::packcode(char *key) {
+  int code = 1;
+  int n = 0;
 
-inline void mcodes::q_sort(long *mkeys, char *mvals, int left, int right) {
-  long pivot, l_hold, r_hold;
-  char pivot_v;
- 
-  l_hold = left;
-  r_hold = right;
-  pivot = mkeys[left];
-  pivot_v = mvals[left];
-    
-  while (left < right)
-  {    
-    while ((mkeys[right] >= pivot) && (left < right))
-      right--;
-    if (left != right)
-    {
-      mkeys[left] = mkeys[right];
-      mvals[left] = mvals[right];
-      left++;
-    }
-    while ((mkeys[left] <= pivot) && (left < right))
-      left++;
-    if (left != right)
-    {
-      mkeys[right] = mkeys[left];
-      mvals[right] = mvals[left];
-      right--;
-    }
+  for (; *key == '1' || *key == '2'; key++) {
+    if (++n > MAXDD)
+      return -1;
+    code = (code << 1) | (*key - '1');
   }
-  mkeys[left] = pivot;
-  mvals[left] = pivot_v;
-  pivot = left;
-  pivot_v = left;
-  left = l_hold;
-  right = r_hold;
-  if (left < pivot)
-    q_sort(mkeys, mvals, left, pivot-1);
-  if (right > pivot)
-    q_sort(mkeys, mvals, pivot+1, right);
-}
-
-// binary search -- adapted from
-// (http://) rosettacode.org/wiki/Binary_search
-inline int mcodes:: getcode(long key, char *val){ 
-    int low = 0, high = cnt-1, mid;
-        
-    while(low <= high) {
-         mid = (low + high) / 2;
-         if(mkey[mid] < key) {
-                        low = mid + 1; 
-                }
-                else if(mkey[mid] == key) {
-                    *val = mval[mid];
-                     return 0;
-                }
-                else if(mkey[mid] > key) {
-                     high = mid-1;
-                }
+  if (n == 0 || isalnum(*key))
+    return -1;
+  return code;
+}
+
+// value of a code, from the SD table or else the built-in one
+inline char mcodes::val(int code) {
+    if (code <= 0 || code >= MTABSZ)
+        return 0;
+    if (mtab[code])
+        return mtab[code];
+    return pgm_read_byte(def_mtab + code);
+}
+
+// direct lookup -- no search, no Serial output on a miss
+inline int mcodes:: getcode(int code, char *v){ 
+    if ((*v = val(code)) != 0)
+        return 0;
+    *v = '?';
+    return -1;
+}
+
+inline int mcodes::live(int code) {
+    if (code <= 0 || code >= MTABSZ)
+        return 0;
+    return (mlive[code >> 3] | pgm_read_byte(def_mlive + (code >> 3))) & (1 << (code & 7));
+}
+
+// fill buf with up to max characters whose codes extend code,
+// one level at a time so the shortest codes come first.
+// lowercase special codes (space, backspace, ...) are left out
+inline int mcodes::reach(int code, char *buf, int max) {
+    int n = 0;
+    int first, last, c;
+    char v;
+
+    if (!live(code))
+        return 0;
+    for (first = code << 1, last = first + 1; last < MTABSZ && n < max;
+         first <<= 1, last = (last << 1) + 1) {
+        for (c = first; c <= last && n < max; c++) {
+            if (live(c) && (v = val(c)) != 0 && !islower(v))
+                buf[n++] = v;
         }
-        *val = '?';
-        Serial.print("not found: ");
-        Serial.println(key, DEC);
-        return -1;
+    }
+    return n;
 }
 
 inline int mcodes:: dumpcodes(char *str){
    char buf[100];
   
-   for (int i = 0; i < cnt; i++) {
-       memset(buf, 1, 100); 
-       sprintf(buf, "%d- %ld : %c\n", i, mkey[i], mval[i]);
+   for (int i = 2; i < MTABSZ; i++) {
+       if (!mtab[i])
+           continue;
+       sprintf(buf, "%d- %c\n", i, mtab[i]);
        strcat(str, buf);
    }
 }
 
 // -----------  short codes -----------------
 inline scodes::scodes() {
-  cnt = 0; 
+  soff = NULL;
+  skey = shash = NULL;
+  slen = NULL;
+  sarena = cval = NULL;
+  cnt = cap = hbits = 0;
+  aused = asize = 0; 
+  sd = 0;
+  sread = NULL;
+  memset(ckey, 0, sizeof(ckey));
+  memset(cuse, 0, sizeof(cuse));
+  ctick = 0;
+}
+
+// allocate the tables for n codes with up to bytes of values in total.
+// in sd mode the values stay on the card, so bytes is not used and
+// room for the phrase cache is taken instead.
+// returns -1 (and keeps no codes) if there is not enough memory. The size
+// is worked out in 32 bits, as n * 7 alone passes 16 bits with a few
+// thousand codes, and anything over SCMAXMEM is refused before malloc
+inline int scodes::reserve(int n, uint32_t bytes, int sdmode) {
+  char *p;
+  int bits;
+  uint32_t size;
+
+  clear();
+  if (n <= 0)
+    return 0;
+  if (n > SCMAXN)
+    return -1;
+  for (bits = 1; (1L << bits) < 2L * n; bits++)  // at most half full
+    ;
+  if (sdmode)
+    bytes = SCACHE * MAXSCODE_TXT;
+
+  size = n * 7UL + (2UL << bits) + bytes;
+  if (size > SCMAXMEM)
+    return -1;
+  p = (char *) malloc(size);
+  if (p == NULL)
+    return -1;
+
+  // wider arrays first to keep them aligned
+  soff = (uint32_t *) p;
+  skey = (uint16_t *)(soff + n);
+  shash = skey + n;
+  slen = (unsigned char *)(shash + (1 << bits));
+  memset(shash, 0, sizeof(*shash) << bits);
+  cap = n;
+  hbits = bits;
+  sd = sdmode;
+  if (sd)
+    cval = (char *)(slen + n);
+  else {
+    sarena = (char *)(slen + n);
+    asize = bytes;
+  }
+  return n;
+}
+
+inline int scodes::clear() {
+  int (*rd)(uint32_t, char *, int) = sread;
+
+  free(soff);
+  *this = scodes();
+  sread = rd;
+  return 0;
+}
+
+// slot of a short code key in a table of 2^bits slots
+// (Fibonacci hashing of the two key chars as one 16 bit word)
+inline int skhash(uint16_t key, int bits) {
+  return (uint16_t)(key * 40503U) >> (16 - bits);
+}
+
+// key of 1 or 2 chars as one word, see scodes::skey
+inline uint16_t skpack(const char *k) {
+  return ((unsigned char) k[0] << 8) | (k[0] ? (unsigned char) k[1] : 0);
 }
 
 // load short codes into class
-inline int scodes::loadcode(char *buf) { 
+// pos is the offset of the line in CODE.CSV, used in sd mode
+inline int scodes::loadcode(char *buf, uint32_t pos) { 
 	char * p;
 	char * p1;
         char * p2;
@@ -164,7 +241,7 @@ inline int scodes::loadcode(char *buf) {
 	char typcode[10];
 	char ktok[10];
 	char vtok[MAXSCODE_TXT];
-	int lineno, i; 
+	int lineno, i, vlen; 
 
         memset(buf1, 0, 100); 
 	strncpy(buf1, buf, MAXSCODE_TXT-1);
@@ -182,37 +259,292 @@ inline int scodes::loadcode(char *buf) {
 	
 	p1 = strtok(NULL, ",");
 	strcpy(vtok, p1);  // value of code, eg, "I am Thirsty"
+        vlen = strlen(vtok);
+
+        if (cnt >= cap || (!sd && aused + vlen > asize))
+            return -1;
   
-	strcpy(skey[cnt], ktok);  
-	strcpy(sval[cnt], vtok);
+	skey[cnt] = skpack(ktok);
+	slen[cnt] = vlen;
+	if (sd)
+	    soff[cnt] = pos + (p1 - buf1);
+	else {
+	    soff[cnt] = aused;
+	    memcpy(sarena + aused, vtok, vlen);
+	    aused += vlen;
+	}
         cnt++;
+        return cnt;
 }
 
+// sort the codes by key and build the hash index
 inline int scodes::sortcode(){ 
+  uint32_t toff;
+  uint16_t tkey;
+  unsigned char tlen;
+  int i, j;
+
+  // insertion sort of the small records -- the arena does not move
+  for (i = 1; i < cnt; i++) {
+    tkey = skey[i];
+    toff = soff[i];
+    tlen = slen[i];
+    for (j = i; j > 0 && skey[j-1] > tkey; j--) {
+      skey[j] = skey[j-1];
+      soff[j] = soff[j-1];
+      slen[j] = slen[j-1];
+    }
+    skey[j] = tkey;
+    soff[j] = toff;
+    slen[j] = tlen;
+  }
+  return index();
+}
+
+// build the hash index of the loaded codes
+inline int scodes::index(){ 
+  int i, h;
+  int mask = (1 << hbits) - 1;
+
+  if (cnt)
+    memset(shash, 0, sizeof(*shash) << hbits);
+  for (i = 0; i < cnt; i++) {
+    for (h = skhash(skey[i], hbits); shash[h]; h = (h + 1) & mask)
+      ;
+    shash[h] = i + 1;
+  }
+  return cnt;
 }
 
 // send k (key), return v (value)
+// returns length of v, or -1 (and v = "?") if not found
 inline int scodes::getcode(char *k, char *v){ 
-  int i, rc, lenk, lencode;
-	int fnd = -1;
-  char buf[100];
-        	
-	for (i=0; i< cnt && fnd < 0; i++) {
-		  if (strcmp(k, skey[i]) == 0) { // code found
-			    strcpy(v, sval[i]);
-			    fnd = i;
-		  }
-	}
-	if (fnd < 0) {
-      Serial.begin(9600);
-      Serial.print("not found: ");
-      Serial.println(k);
-	    strcpy(v, "?");
-         rc = fnd;
+  int h, i;
+  int mask = (1 << hbits) - 1;
+  int klen = strlen(k);
+  uint16_t key = skpack(k);
+
+  if (klen == 0 || klen > 2) {
+    strcpy(v, "?");
+    return -1;
+  }
+  for (h = skhash(key, hbits); cnt && shash[h]; h = (h + 1) & mask) {
+    i = shash[h] - 1;
+    if (skey[i] == key) { // code found
+      if (sd)
+        return getcached(i, v, 1);
+      memcpy(v, sarena + soff[i], slen[i]);
+      v[slen[i]] = 0;
+      return slen[i];
+    }
+  }
+  if (getdefault(k, v) >= 0)
+    return strlen(v);
+  strcpy(v, "?");
+  return -1;
+}
+
+// value of code i in sd mode -- from the cache, or else (if rd) read from
+// CODE.CSV into the least recently used cache slot
+inline int scodes::getcached(int i, char *v, int rd){ 
+  int c, old = 0;
+  char *cv;
+
+  for (c = 0; c < SCACHE; c++) {
+    if (ckey[c] == skey[i])
+      break;
+    if ((uint16_t)(ctick - cuse[c]) > (uint16_t)(ctick - cuse[old]))
+      old = c;
+  }
+  if (c == SCACHE) { // not cached
+    if (!rd) {
+      v[0] = 0;
+      return -1;
+    }
+    c = old;
+    cv = cval + c * MAXSCODE_TXT;
+    ckey[c] = 0;
+    if (sread == NULL || sread(soff[i], cv, slen[i]) != slen[i]) {
+      strcpy(v, "?");
+      return -1;
+    }
+    ckey[c] = skey[i];
+  }
+  cuse[c] = ++ctick;
+  memcpy(v, cval + c * MAXSCODE_TXT, slen[i]);
+  v[slen[i]] = 0;
+  return slen[i];
+}
+
+// built-in short codes, through the hash index built by tools/m2gc.cpp
+inline int scodes::getdefault(char *k, char *v){ 
+  int h, i;
+  int mask = (1 << DEF_SHASHBITS) - 1;
+  uint16_t key = skpack(k);
+
+  for (h = skhash(key, DEF_SHASHBITS); pgm_read_word(def_shash + h); h = (h + 1) & mask) {
+    i = pgm_read_word(def_shash + h) - 1;
+    if (pgm_read_byte(&def_skey[i][0]) == k[0] && pgm_read_byte(&def_skey[i][1]) == k[1]) {
+      strcpy_P(v, def_sval + pgm_read_word(def_soff + i));
+      return i;
+    }
+  }
+  return -1;
+}
+
+// packed key of built-in code i, see skpack
+inline uint16_t sdefkey(int i) {
+  return (pgm_read_byte(&def_skey[i][0]) << 8) | pgm_read_byte(&def_skey[i][1]);
+}
+
+// first of the sorted keys that is not below key
+inline int scodes::lower(uint16_t key){ 
+  int i = 0, j = cnt, m;
+
+  while (i < j) {
+    m = (i + j) / 2;
+    if (skey[m] < key)
+      i = m + 1;
+    else
+      j = m;
+  }
+  return i;
+}
+
+// count the codes whose key starts with k (0 to 2 chars): the SD codes and
+// the built-in codes they do not replace. The first match in key order
+// goes in fk, its value in v. Both key lists are sorted, so this is a
+// binary search into each and a walk over the matches only, on the keys
+// in RAM. In sd mode the value of a partial key is only shown if it is
+// cached; the card is read once the key is complete, which also has it
+// ready for the Enter that follows.
+inline int scodes::prefix(char *k, char *fk, char *v){ 
+  int klen = strlen(k);
+  int i, j, m, n, fi = -1, fj = -1;
+  uint16_t lo, hi, a, b, first = 0;
+
+  fk[0] = v[0] = 0;
+  if (klen > 2)
+    return 0;
+  lo = skpack(k);
+  hi = klen == 2 ? lo : (klen == 1 ? lo | 0xFF : 0xFFFF);
+
+  i = lower(lo);
+  for (j = 0, m = DEF_SCNT; j < m; ) {
+    if (sdefkey((j + m) / 2) < lo)
+      j = (j + m) / 2 + 1;
+    else
+      m = (j + m) / 2;
+  }
+
+  // merge the two ranges, a key in both counts once
+  for (n = 0; ; n++) {
+    a = (i < cnt && skey[i] <= hi) ? skey[i] : 0;
+    b = (j < DEF_SCNT && sdefkey(j) <= hi) ? sdefkey(j) : 0;
+    if (!a && !b)
+      break;
+    if (a && (!b || a <= b)) {
+      if (!first) {
+        first = a;
+        fi = i;
+      }
+      if (a == b)
+        j++;
+      i++;
+    }
+    else {
+      if (!first) {
+        first = b;
+        fj = j;
+      }
+      j++;
+    }
+  }
+
+  if (n) {
+    fk[0] = first >> 8;
+    fk[1] = first & 0xFF;
+    fk[2] = 0;
+    if (fj >= 0)
+      strcpy_P(v, def_sval + pgm_read_word(def_soff + fj));
+    else if (sd)
+      getcached(fi, v, klen == 2);
+    else {
+      memcpy(v, sarena + soff[fi], slen[fi]);
+      v[slen[fi]] = 0;
+    }
+  }
+  return n;
+}
+
+// key of the nth code (0 based) of the card and built-in codes merged in
+// key order, as in prefix. Returns 0 if there are not that many
+inline int scodes::nth(int n, char *fk) {
+  int i = 0, j = 0;
+  uint16_t a, b, k;
+
+  for (;;) {
+    a = i < cnt ? skey[i] : 0;
+    b = j < DEF_SCNT ? sdefkey(j) : 0;
+    if (!a && !b)
+      return 0;
+    if (a && (!b || a <= b)) {
+      k = a;
+      if (a == b)
+        j++;
+      i++;
+    }
+    else {
+      k = b;
+      j++;
+    }
+    if (n-- == 0)
+      break;
+  }
+  fk[0] = k >> 8;
+  fk[1] = k & 0xFF;
+  fk[2] = 0;
+  return 1;
+}
+
+// -----------  short code sizing -----------------
+inline scount::scount() {
+  lines = bytes = 0;
+  col = field = len = 0;
+  scode = 0;
+}
+
+// count the scode lines in a block of CODE.CSV and the length of their
+// values, the same way SD_fgets and scodes::loadcode will split them
+inline int scount::add(char *blk, int n) {
+  int i;
+  char c;
+
+  for (i = 0; i < n; i++) {
+    c = blk[i];
+    if (col++ == 0)
+      scode = (c == 's');
+    if (c == '\n' || col == 99) {  // end of line, or SD_fgets buffer full
+      done();
+      continue;
+    }
+    if (c == ',')
+      field++;
+    else if (scode && field == 2 && col < MAXSCODE_TXT)
+      len++;
+  }
+  return lines;
+}
+
+// end of file -- count the last line
+inline int scount::done() {
+  if (scode && col > 0 && lines < SCMAXN + 1) {  // enough to be refused
+    lines++;
+    bytes += len;
   }
-      else
-         rc = strlen(v);
-	return (rc);
+  col = field = len = 0;
+  scode = 0;
+  return lines;
 }
 
 // -----------  parameter codes - timing variables -----------------
@@ -285,6 +617,36 @@ inline int pcodes::clear(){
        pvc = 0;
 }
 
+// ---------------- decoder functions ------------------
+
+inline mdecoder::mdecoder() {
+  clear();
+}
+
+inline int mdecoder::clear() {
+  cur = 1;
+  return cur;
+}
+
+inline int mdecoder::push(int c) {
+  cur = (cur << 1) | (c - 1);
+  return cur;
+}
+
+inline int mdecoder::pop() {
+  if (cur > 1)
+    cur >>= 1;
+  return cur;
+}
+
+inline int mdecoder::match(mcodes &mc, char *val) {
+  return mc.getcode(cur, val);
+}
+
+inline int mdecoder::reach(mcodes &mc, char *buf, int max) {
+  return mc.reach(cur, buf, max);
+}
+
 // ---------------- character functions ------------------
 
 inline char_stk::char_stk() {
@@ -295,11 +657,15 @@ inline int char_stk::clear() {
   for (int i=0; i < MAXDD; i++)
     ditdah[i] = 0;
   ptr = 0;
+  dec.clear();
 }
 
+// push a dit (1) or dah (2)
 inline int char_stk::push(int c) {
-  if (ptr < MAXDD)
+  if (ptr < MAXDD) {
     ditdah[ptr++] = c;
+    dec.push(c);
+  }
   return ptr;    
 }
 
@@ -308,26 +674,23 @@ inline int char_stk::size() {
 }
 
 inline int char_stk::pop() {
-  if (ptr >= 0) {
-    ditdah[ptr] = 0;
+  if (ptr > 0) {
     ptr--;
+    ditdah[ptr] = 0;
+    dec.pop();
   } 
+  return ptr;
 }
 
-// get value of character, eg, 12 or 2112
+// get packed code of character, eg, 0b101 for .-
 // returns value of ptr, ditdah[] (n and dd)
-inline long char_stk::get_charval(int &n, int *dd) {
-  long mult = 1;
+inline int char_stk::get_charval(int &n, int *dd) {
   int i;
-  long ch = 0;
   
   n = ptr; 
-  for (i = ptr-1; i > -1; i--) {
+  for (i = 0; i < ptr; i++)
     dd[i] = ditdah[i];
-    ch = ch + (ditdah[i] * mult);
-    mult = mult * 10;
-  }
-  return ch;
+  return dec.cur;
 }
 
 // -------------- word functions ----------------
@@ -410,51 +773,805 @@ inline int word_stk::get_pword(char* pwrd) {
 
 // ----------- Message functions ---------------
 inline message_stk::message_stk() {
-  msg = (char **)malloc(MAXWORDS * sizeof(char *));
-  ptr = 0; 
+  clear();
 }
 
 // clear stack 
 inline int message_stk::clear() {
-   int i; 
-   for (i=0; i< ptr; i++)
-       free(msg[i]); 
-   ptr = 0; 
+   first = head = used = ptr = 0; 
+   drop = 0;
+   return 0;
 }
 
-// push a word to the stack 
+// push a word to the stack, words longer than MAXWORD-1 are cut
 inline int message_stk::push(char* wrd) {
-    int i; 
+    int i, n; 
 
-    // if stack full, return with no action
-    if (ptr > MAXWORDS-1) 
-        return ptr;
-        
-    i = strlen(wrd); 
-    msg[ptr] = (char *)malloc(i + 1);
-    strcpy(msg[ptr], wrd);
+    n = strlen(wrd); 
+    if (n > MAXWORD - 1)
+        n = MAXWORD - 1;
+
+    // if stack full, drop the oldest words
+    while (ptr > 0 && (ptr == MAXWORDS || used + n + 1 > MSGBUF)) {
+        used -= len[first];
+        drop += len[first];
+        first = (first + 1) % MAXWORDS;
+        ptr--;
+    }
+
+    i = (first + ptr) % MAXWORDS;
+    off[i] = head;
+    len[i] = n + 1;
+    while (n-- > 0) {
+        buf[head] = *wrd++;
+        head = (head + 1) % MSGBUF;
+    }
+    buf[head] = ' ';
+    head = (head + 1) % MSGBUF;
+    used += len[i];
     ptr++;
     return ptr; 
 }
 
-// pop a word from the stack
+// pop a word from the stack into wrd
 inline int message_stk::pop(char* wrd) {
+   int i;
+
+   if (ptr == 0) {
+       wrd[0] = 0;
+       return 0;
+   }
+   get_msg(ptr - 1, wrd);
+   i = (first + ptr - 1) % MAXWORDS;
+   head = off[i];
+   used -= len[i];
    ptr--;
-   free(msg[ptr]); 
    return ptr; 
 }
 
-// get word n from the stack 
+// get word n from the stack, 0 is the oldest (the last one if n is
+// out of range)
 inline int message_stk::get_msg(int n, char *wrd) {
-   if (n >= 0 && n < ptr) 
-       strcpy(wrd, msg[n]); 
-   else
-       strcpy(wrd, msg[ptr-1]); 
+   int i, j, k;
+
+   if (ptr == 0) {
+       wrd[0] = 0;
+       return n;
+   }
+   i = (n >= 0 && n < ptr) ? n : ptr - 1;
+   i = (first + i) % MAXWORDS;
+   for (j = off[i], k = 0; k < len[i] - 1; k++) {
+       wrd[k] = buf[j];
+       j = (j + 1) % MSGBUF;
+   }
+   wrd[k] = 0;
 
    return n;
 }
 
+// length of the message text from byte pos (0 is the start of the oldest
+// word) that fits in max bytes and ends after a word. 0 at the end
+inline int message_stk::chunk(int pos, int max) {
+   int n;
+
+   if (pos >= used)
+       return 0;
+   if (used - pos <= max)
+       return used - pos;
+   for (n = max; n > 0 && at(pos + n - 1) != ' '; n--)
+       ;
+   return n ? n : max;  // cut a word only if it is longer than max
+}
+
+// byte pos of the message text, see chunk
+inline char message_stk::at(int pos) {
+   return buf[(off[first] + pos) % MSGBUF];
+}
+
 // get ptr  
 inline int message_stk::get_ptr() {
    return ptr;
 } 
+
+// ----------- debouncer ---------------
+inline debouncer::debouncer() {
+  state = (swbits) ~0;  // all open
+  cnt0 = cnt1 = (swbits) ~0;
+}
+
+// vertical counters: count down 3, 2, 1, 0 for the switches that differ,
+// reset to 3 for the rest
+inline swbits debouncer::update(swbits sample) {
+  swbits d = state ^ sample;
+
+  cnt0 = ~(cnt0 & d);
+  cnt1 = cnt0 ^ (cnt1 & d);
+  d &= cnt0 & cnt1;  // count wrapped
+  state ^= d;
+  return d;
+}
+
+// ----------- button edges ---------------
+inline edge_q::edge_q() {
+  head = tail = 0;
+}
+
+// queue an edge of button b, 0 if the queue is full
+inline int edge_q::put(int b, int down, unsigned long t) {
+  unsigned char h = head;
+
+  if ((unsigned char)(h - tail) == EDGEQ)
+    return 0;
+  q[h % EDGEQ].btn = b;
+  q[h % EDGEQ].down = down;
+  q[h % EDGEQ].t = t;
+  head = h + 1;  // publish after the edge is written
+  return 1;
+}
+
+// take the oldest edge, 0 if none
+inline int edge_q::get(BtnEdge &e) {
+  unsigned char t = tail;
+
+  if (t == head)
+    return 0;
+  e.btn = q[t % EDGEQ].btn;
+  e.down = q[t % EDGEQ].down;
+  e.t = q[t % EDGEQ].t;
+  tail = t + 1;  // free the slot after it is read
+  return 1;
+}
+
+// ----------- gestures ---------------
+// states of a button
+#define GS_UP 0
+#define GS_DOWN 1
+#define GS_WAIT 2  // tapped, waiting for a second tap
+#define GS_DOWN2 3  // second tap down
+#define GS_RPT 4  // held and repeating
+#define GS_CHORD 5  // down as part of a chord
+
+// built-in table: row, gesture, action
+const unsigned char def_gest[][3] PROGMEM = {
+  {0, G_TAP, A_DIT},  {0, G_LONG, A_ENTER},
+  {1, G_TAP, A_DAH},  {1, G_LONG, A_DELETE},
+  {2, G_TAP, A_ENTER},
+  {3, G_TAP, A_DELETE},
+};
+
+// names in gcode lines, in column and action order
+const char *const gest_names[NGEST] = {"tap", "long", "double", "repeat"};
+const char *const act_names[] = {"none", "dit", "dah", "enter", "delete",
+  "space", "speak", "bksp", "clear", NULL};
+
+inline gestures::gestures() {
+  clear();
+}
+
+// built-in table, all buttons up
+inline int gestures::clear() {
+  int i;
+
+  memset(this, 0, sizeof(*this));
+  for (i = 0; i < (int)(sizeof(def_gest) / 3); i++)
+    gtab[pgm_read_byte(&def_gest[i][0])][pgm_read_byte(&def_gest[i][1])] =
+        pgm_read_byte(&def_gest[i][2]);
+  return 0;
+}
+
+// row of gtab for the chord of buttons a and b (0 based)
+inline int gestures::row(int a, int b) {
+  int t;
+
+  if (a > b) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  return NBTN + a * (2 * NBTN - a - 1) / 2 + (b - a - 1);
+}
+
+// load a gcode line, eg "gcode,3,double,speak" or "gcode,12,tap,space"
+// returns -1 if a field is not known
+inline int gestures::loadcode(char *buf) { 
+  char buf1[100];
+  char *p1;
+  int r, g, a;
+
+  memset(buf1, 0, 100);
+  strncpy(buf1, buf, 99);
+  p1 = strtok(buf1, ",");  // type of code - gcode
+
+  p1 = strtok(NULL, ",");  // button, or 2 buttons of a chord
+  if (p1 == NULL || p1[0] < '1' || p1[0] > '0' + NBTN)
+    return -1;
+  r = p1[0] - '1';
+  if (p1[1]) {
+    if (p1[1] < '1' || p1[1] > '0' + NBTN || p1[1] == p1[0])
+      return -1;
+    r = row(r, p1[1] - '1');
+  }
+
+  p1 = strtok(NULL, ",");
+  for (g = 0; p1 && g < NGEST && strcmp(p1, gest_names[g]); g++)
+    ;
+  p1 = strtok(NULL, ",\r");
+  for (a = 0; p1 && act_names[a] && strcmp(p1, act_names[a]); a++)
+    ;
+  if (p1 == NULL || g == NGEST || act_names[a] == NULL)
+    return -1;
+  gtab[r][g] = a;
+  return r;
+}
+
+// take a button edge, return the action it completes (A_NONE if none yet)
+inline int gestures::feed(BtnEdge &e, int lp) {
+  int b = e.btn, o, r;
+  unsigned long held;
+
+  if (e.down) {
+    for (o = 0; o < NBTN; o++) {
+      if (st[o] == GS_WAIT && o != b) {  // a new press ends the wait
+        st[o] = GS_UP;
+        pend |= 1 << o;
+      }
+      r = o != b ? row(o, b) : 0;
+      if (o != b && (st[o] == GS_DOWN || st[o] == GS_DOWN2) &&
+          (gtab[r][G_TAP] || gtab[r][G_LONG])) {
+        st[o] = st[b] = GS_CHORD;
+        crow = r;
+        clong = 0;
+        tdown[b] = e.t;
+        return due();
+      }
+    }
+    st[b] = st[b] == GS_WAIT ? GS_DOWN2 : GS_DOWN;
+    tdown[b] = e.t;
+    tnext[b] = e.t + lp * 1000UL;  // first repeat
+    return due();
+  }
+
+  held = (e.t - tdown[b]) / 1000;
+  switch (st[b]) {
+    case GS_CHORD:  // the chord is done when its last button is up
+      st[b] = GS_UP;
+      if (held > (unsigned long) lp)
+        clong = 1;
+      for (o = 0; o < NBTN; o++)
+        if (st[o] == GS_CHORD)
+          return A_NONE;
+      return gtab[crow][clong && gtab[crow][G_LONG] ? G_LONG : G_TAP];
+    case GS_DOWN2:
+      st[b] = GS_UP;
+      return gtab[b][G_DOUBLE];
+    case GS_DOWN:
+      st[b] = GS_UP;
+      if (held > (unsigned long) lp && gtab[b][G_LONG])
+        return gtab[b][G_LONG];
+      if (gtab[b][G_DOUBLE]) {
+        st[b] = GS_WAIT;
+        tnext[b] = e.t + DBLTAP * 1000UL;
+        return A_NONE;
+      }
+      return gtab[b][G_TAP];
+  }
+  st[b] = GS_UP;
+  return A_NONE;
+}
+
+// action that is due with no new edge: a tap whose double tap wait is over,
+// or a repeat of a held button
+inline int gestures::poll(unsigned long now) {
+  int b, a;
+
+  if ((a = due()) != A_NONE)
+    return a;
+  for (b = 0; b < NBTN; b++) {
+    if (st[b] == GS_WAIT && (long)(now - tnext[b]) >= 0) {
+      st[b] = GS_UP;
+      return gtab[b][G_TAP];
+    }
+    if ((st[b] == GS_DOWN || st[b] == GS_RPT) && gtab[b][G_REPEAT] &&
+        (long)(now - tnext[b]) >= 0) {
+      st[b] = GS_RPT;
+      tnext[b] += RPTMS * 1000UL;
+      return gtab[b][G_REPEAT];
+    }
+  }
+  return A_NONE;
+}
+
+// tap of a button whose wait was ended by another press, the one that
+// was released first; the others stay in pend for the next call
+inline int gestures::due() {
+  int b, f, a;
+
+  while (pend) {
+    f = -1;
+    for (b = 0; b < NBTN; b++)
+      if ((pend >> b & 1) && (f < 0 || (long)(tnext[b] - tnext[f]) < 0))
+        f = b;
+    pend &= ~(1 << f);
+    if ((a = gtab[f][G_TAP]) != A_NONE)
+      return a;
+  }
+  return A_NONE;
+}
+
+// how long the button held longest has been down, of those whose release
+// can still be a long press or end a chord; 0 if none
+inline unsigned long gestures::held(unsigned long now) {
+  unsigned long h = 0;
+  int b;
+
+  for (b = 0; b < NBTN; b++)
+    if ((st[b] == GS_DOWN && gtab[b][G_LONG]) || st[b] == GS_CHORD)
+      if (now - tdown[b] > h)
+        h = now - tdown[b];
+  return h;
+}
+
+// ----------- keyer functions ---------------
+
+inline keyer::keyer() {
+  mode = K_OFF;
+  busy = mem = 0;
+  last = A_DAH;
+  tend = 0;
+  set(K_OFF, KEYWPM);
+}
+
+// words per minute are kept to 5 - 50, so a dit fits in unit
+inline int keyer::set(int m, int wpm) {
+  if (wpm < 5)
+    wpm = 5;
+  else if (wpm > 50)
+    wpm = 50;
+  unit = 1200 / wpm;
+  mode = m;
+  return wpm;
+}
+
+inline void keyer::tick(swbits pad, unsigned long now) {
+  unsigned char el;
+
+  if (mode == K_OFF)
+    return;
+  if (busy && (long)(now - tend) < 0) {
+    if (pad & (last == A_DIT ? 2 : 1))
+      mem = 1;
+    return;
+  }
+  busy = 0;
+  if ((pad & 3) == 3)  // squeeze
+    el = last == A_DIT ? A_DAH : A_DIT;
+  else if (pad & 1)
+    el = A_DIT;
+  else if (pad & 2)
+    el = A_DAH;
+  else if (mem && mode == K_IAMBIC_B)
+    el = last == A_DIT ? A_DAH : A_DIT;
+  else {
+    mem = 0;
+    last = A_DAH;  // a squeeze from rest starts with a dit
+    return;
+  }
+  if (!out.put(el, 1, now))
+    return;  // loop() is behind, try again next tick
+  mem = 0;
+  last = el;
+  busy = 1;
+  tend = now + (el == A_DIT ? 2UL : 4UL) * unit * 1000UL;  // and a dit of space
+}
+
+// ----------- lptuner functions ---------------
+
+inline lptuner::lptuner() {
+  clear();
+}
+
+inline int lptuner::clear() {
+  memset(hist, 0, sizeof(hist));
+  n = 0;
+  misfire = 0;
+  waslong = 0;
+  tlong = 0;
+  longact = A_NONE;
+  return 0;
+}
+
+// count a release of a single press on a button that has both a tap and a
+// long press; chords, double taps and repeats say nothing about the
+// threshold. Returns the press length in ms, or -1 if it was not counted
+inline int lptuner::edge(gestures &g, BtnEdge &e, int lp) {
+  int b = e.btn, i;
+  unsigned long ms;
+
+  if (e.down || g.st[b] != GS_DOWN || !g.gtab[b][G_TAP] || !g.gtab[b][G_LONG])
+    return -1;
+  ms = (e.t - g.tdown[b]) / 1000;
+  waslong = ms > (unsigned long) lp;
+  i = ms / LPBIN < LPBINS ? ms / LPBIN : LPBINS - 1;
+  if (hist[i] == 255) {  // keep the recent presses weighted the same
+    for (n = 0, b = 0; b < LPBINS; b++)
+      n += hist[b] >>= 1;
+  }
+  hist[i]++;
+  n++;
+  return ms;
+}
+
+// a Delete soon after a long press, with nothing in between, is taken as
+// a long press that was meant to be short. Not if the long press was a
+// Delete itself: that is a run of deletes, eg on button 2
+inline int lptuner::action(int act, unsigned long now) {
+  if (act == A_DELETE && tlong && longact != A_DELETE && now - tlong < LPUNDO)
+    misfire++;
+  tlong = waslong ? (now ? now : 1) : 0;
+  longact = act;
+  waslong = 0;
+  return misfire;
+}
+
+// the split of hist with the most variance between the two sides. When
+// several splits tie (an empty gap between short and long presses) the
+// middle of the gap is used. Until some presses are longer than lp, the
+// Long Press in use, there are only taps and nothing to split
+inline int lptuner::suggest(int lp) {
+  long w0 = 0, s0 = 0, sum = 0, nlong = 0;
+  float m0, m1, v, best = -1;
+  int k, k0 = 0, k1 = 0, ms;
+
+  if (n < LPMIN)
+    return -1;
+  for (k = 0; k < LPBINS; k++) {
+    sum += (long) k * hist[k];
+    if (k * LPBIN >= lp)
+      nlong += hist[k];
+  }
+  if (nlong < LPMINC)
+    return -1;
+  for (k = 0; k < LPBINS - 1; k++) {
+    w0 += hist[k];
+    s0 += (long) k * hist[k];
+    if (w0 < LPMINC || n - w0 < LPMINC)
+      continue;
+    m0 = (float) s0 / w0;
+    m1 = (float) (sum - s0) / (n - w0);
+    v = (float) w0 * (n - w0) * (m1 - m0) * (m1 - m0);
+    if (v > best) {
+      best = v;
+      k0 = k1 = k;
+    }
+    else if (v == best && k1 == k - 1)
+      k1 = k;
+  }
+  if (best < 0)
+    return -1;
+  ms = (k0 + k1 + 2) * LPBIN / 2;  // between bins k and k + 1
+  return ms < 300 ? 300 : ms > 1500 ? 1500 : ms;
+}
+
+// ----------- twheel functions ---------------
+
+inline twheel::twheel() {
+  tnow = 0;
+  cur = armed = 0;
+  memset(head, 0, sizeof(head));
+  memset(next, 0, sizeof(next));
+  memset(prev, 0, sizeof(prev));
+  memset(slot, TWSLOTS, sizeof(slot));
+  memset(turns, 0, sizeof(turns));
+}
+
+// (re)arm timer t to expire ms after now
+inline int twheel::arm(int t, unsigned ms, unsigned long now) {
+  unsigned long ticks;
+  int s;
+
+  cancel(t);
+  if (!armed)  // nothing to run, so the wheel may have fallen behind
+    tnow = now;
+  ticks = (ms + (now - tnow) + TWTICK - 1) / TWTICK;
+  if (ticks == 0)
+    ticks = 1;
+  s = (cur + ticks) & (TWSLOTS - 1);
+  turns[t] = (ticks - 1) / TWSLOTS;
+  slot[t] = s;
+  prev[t] = 0;
+  next[t] = head[s];
+  if (head[s])
+    prev[head[s] - 1] = t + 1;
+  head[s] = t + 1;
+  armed++;
+  return s;
+}
+
+inline int twheel::cancel(int t) {
+  if (slot[t] == TWSLOTS)
+    return 0;
+  if (prev[t])
+    next[prev[t] - 1] = next[t];
+  else
+    head[slot[t]] = next[t];
+  if (next[t])
+    prev[next[t] - 1] = prev[t];
+  slot[t] = TWSLOTS;
+  armed--;
+  return 1;
+}
+
+inline int twheel::run(unsigned long now) {
+  int fired = 0, t, n;
+
+  while (armed && now - tnow >= TWTICK) {
+    tnow += TWTICK;
+    cur = (cur + 1) & (TWSLOTS - 1);
+    for (t = head[cur] - 1; t >= 0; t = n) {
+      n = next[t] - 1;
+      if (turns[t])
+        turns[t]--;
+      else {
+        cancel(t);
+        fired |= 1 << t;
+      }
+    }
+  }
+  return fired;
+}
+
+// ----------- scanner functions ---------------
+
+// cells are ranked by the steps to reach them: row + group + cell
+inline scanner::scanner() {
+  int c, d, n = 0;
+
+  for (d = 0; d < SCROWS + SCCOLS / SCGRP + SCGRP; d++)
+    for (c = 0; c < SCCELLS; c++)
+      if (c / SCCOLS + c % SCCOLS / SCGRP + c % SCGRP == d)
+        rank[c] = n++;
+  rate = SCANMS;
+  start(0);
+}
+
+inline int scanner::start(unsigned long now) {
+  level = 0;
+  at[0] = at[1] = at[2] = 0;
+  loops = 0;
+  clean = 1;
+  tnext = now + rate;
+  return 0;
+}
+
+inline int scanner::count() {
+  return level == 0 ? SCROWS : level == 1 ? SCCOLS / SCGRP : SCGRP;
+}
+
+inline int scanner::step(unsigned long now) {
+  if ((long)(now - tnext) < 0)
+    return 0;
+  tnext = now + rate;
+  if (++at[level] < count())
+    return 1;
+  at[level] = 0;
+  if (level == 0)
+    loops = 1;
+  else if (++loops >= SCLOOPS) {  // pressed on the wrong row or group
+    adapt(0);
+    start(now);
+  }
+  return 1;
+}
+
+// a new level stays on its first item a little longer, to give time to
+// see where the scan has gone
+inline int scanner::press(unsigned long now) {
+  int c;
+
+  if (loops)
+    clean = 0;
+  if (level < 2) {
+    at[++level] = 0;
+    loops = 0;
+    tnext = now + rate + rate / 2;
+    return -1;
+  }
+  c = at[0] * SCCOLS + at[1] * SCGRP + at[2];
+  if (clean)
+    adapt(1);
+  start(now);
+  return c;
+}
+
+inline int scanner::first() {
+  return at[0] * SCCOLS + (level > 0 ? at[1] * SCGRP : 0) + (level > 1 ? at[2] : 0);
+}
+
+inline int scanner::last() {
+  return first() + (level == 0 ? SCCOLS : level == 1 ? SCGRP : 1) - 1;
+}
+
+inline int scanner::adapt(int good) {
+  if (good)
+    rate -= rate / 16;
+  else
+    rate += rate / 4;
+  if (rate < SCANMIN)
+    rate = SCANMIN;
+  else if (rate > SCANMAX)
+    rate = SCANMAX;
+  return rate;
+}
+
+// ----------- textgrid functions ---------------
+
+// the screen starts blank
+inline textgrid::textgrid() {
+  int r, b = 0;
+
+  for (r = 0; r < 5; r++)
+    b = setup(G_MSG + r, 0, r * SIZER, SIZEC, PRFN, NCOL, b);
+  b = setup(G_WORD, 0, WORDROW * SIZER, SIZEC, PRFN, NCOL, b);
+  b = setup(G_DITS, 3 * SIZEC, 6 * SIZER, 6 * PRFN, PRFN, MAXDD, b);
+  b = setup(G_CHAR, 11 * SIZEC, 6 * SIZER, 6 * PRFN, PRFN, GCHAR, b);
+  b = setup(G_CAND, 3 * SIZEC, 6 * SIZER + CANDROW, 6, 1, MAXCAND, b);
+  b = setup(G_LAB3, 2 * SIZEC, 7 * SIZER, 12, 2, 11, b);
+  b = setup(G_LAB4, 10 * SIZEC, 7 * SIZER, 12, 2, 12, b);
+  setup(G_MATCH, 2 * SIZEC, 7 * SIZER + MATCHROW, 6, 1, GMATCH, b);
+  memset(ch, ' ', GCELLS);
+  memset(at, 0, GCELLS);
+  memset(dirty, 0, sizeof(dirty));
+  pend = 0;
+}
+
+// geometry of line l, its cells start at b; returns the next free cell
+inline int textgrid::setup(int l, int px, int py, int p, int s, int cells, int b) {
+  x[l] = px;
+  y[l] = py;
+  pitch[l] = p;
+  size[l] = s;
+  n[l] = cells;
+  base[l] = b;
+  return b + cells;
+}
+
+inline int textgrid::put(int l, int c, char k, char a) {
+  int i;
+
+  if (c < 0 || c >= n[l])
+    return 0;
+  i = base[l] + c;
+  if (k == ' ')
+    a = 0;
+  if (ch[i] == k && at[i] == a)
+    return 0;
+  ch[i] = k;
+  at[i] = a;
+  mark(i);
+  return 1;
+}
+
+inline int textgrid::text(int l, int c, const char *s, char a) {
+  int m = 0;
+
+  for (; c < n[l]; c++)
+    m += put(l, c, *s ? *s++ : ' ', a);
+  return m;
+}
+
+// lines l0 to l1, all of the same length, up k lines; the last k are
+// blanked. Only the cells that differ from the line k below are drawn
+// again, a blank row costs nothing
+inline int textgrid::scroll(int l0, int l1, int k) {
+  int l, c, m = 0;
+
+  for (l = l0; l <= l1 - k; l++)
+    for (c = 0; c < n[l]; c++)
+      m += put(l, c, ch[base[l + k] + c], at[base[l + k] + c]);
+  for (; l <= l1; l++)
+    m += text(l, 0, "", 0);
+  return m;
+}
+
+inline int textgrid::redraw(int l) {
+  int i, m = 0;
+
+  for (i = base[l]; i < base[l] + n[l]; i++)
+    if (ch[i] != ' ')
+      m += mark(i);
+  return m;
+}
+
+inline int textgrid::mark(int i) {
+  if (dirty[i >> 3] & (1 << (i & 7)))
+    return 0;
+  dirty[i >> 3] |= 1 << (i & 7);
+  pend++;
+  return 1;
+}
+
+// cells k to draw from cell c of line l, in lines before lmax. A run of
+// blanks comes as one, to be filled in one go, but no wider than two
+// glyphs so that no one fill takes much longer than a glyph; a glyph on
+// its own
+inline int textgrid::next(int lmax, int *l, int *c, int *k) {
+  int i, j;
+
+  for (*l = 0; *l < lmax; (*l)++)
+    for (i = base[*l]; i < base[*l] + n[*l]; i++) {
+      if (!(dirty[i >> 3] & (1 << (i & 7))))
+        continue;
+      dirty[i >> 3] &= ~(1 << (i & 7));
+      *c = i - base[*l];
+      *k = 1;
+      for (j = i + 1; ch[i] == ' ' && j < base[*l] + n[*l] && ch[j] == ' ' &&
+           (dirty[j >> 3] & (1 << (j & 7))) && (*k + 1) * pitch[*l] <= 12 * size[*l]; j++) {
+        dirty[j >> 3] &= ~(1 << (j & 7));
+        (*k)++;
+      }
+      pend -= *k;
+      spill(*l, *c, *k);
+      return 1;
+    }
+  return 0;
+}
+
+// the cells that drawing k cells from c of line l draws over: the glyph
+// cells after them in the line, and any cell of a later line they cross.
+// Those are marked, so the later cells come out on top
+inline int textgrid::spill(int l, int c, int k) {
+  int i, l2, x0, x1, cx, m = 0;
+
+  i = base[l] + c + k - 1;
+  x0 = x[l] + c * pitch[l];
+  x1 = x[l] + (c + k - 1) * pitch[l] + (ch[i] == ' ' ? pitch[l] : 6 * size[l]);
+  for (l2 = l; l2 < GLINES; l2++) {
+    if (l2 != l && (y[l2] >= y[l] + 8 * size[l] || y[l] >= y[l2] + 8 * size[l2]))
+      continue;
+    for (i = l2 == l ? c + k : 0; i < n[l2]; i++) {
+      cx = x[l2] + i * pitch[l2];
+      if (cx >= x1 || x0 >= cx + 6 * size[l2])
+        continue;
+      if (l2 != l || ch[base[l2] + i] != ' ')
+        m += mark(base[l2] + i);
+    }
+  }
+  return m;
+}
+
+// ----------- CODE.BIN functions ---------------
+
+// CRC-32 (IEEE 802.3) of n bytes, continuing from crc (0 to start).
+// bitwise rather than table driven to keep 1K of table out of SRAM
+inline uint32_t crc32_update(uint32_t crc, const unsigned char *p, int n) {
+   int k;
+
+   crc = ~crc;
+   while (n-- > 0) {
+       crc ^= *p++;
+       for (k = 0; k < 8; k++)
+           crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+   }
+   return ~crc;
+}
+
+// sections of CODE.BIN that follow the header, in file order.
+// s must already be reserved for h.scnt codes, h.sbytes of values and
+// the sd mode in h.flags
+inline int codebin_map(CodeBinHdr &h, mcodes &m, scodes &s, gestures &g, char **ptr, int *len) {
+   ptr[0] = m.mtab;
+   len[0] = MTABSZ;
+   ptr[1] = (char *) m.mlive;
+   len[1] = MTABSZ / 8;
+   ptr[2] = (char *) s.skey;
+   len[2] = h.scnt * 2;
+   ptr[3] = (char *) s.soff;
+   len[3] = h.scnt * 4;
+   ptr[4] = (char *) s.slen;
+   len[4] = h.scnt;
+   ptr[5] = s.sarena;
+   len[5] = h.sbytes;
+   ptr[6] = (char *) g.gtab;
+   len[6] = sizeof(g.gtab);
+   return BINSECTS;
+}
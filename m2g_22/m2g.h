@@ -24,12 +24,50 @@ any lines above THIS line.
 */
 
 #define MAXDD 6
+#define MTABSZ (2 << MAXDD)  // packed morse codes of 1 to MAXDD elements
+#define MAXCAND 16  // possible next letters shown under the char buffer
+#define CANDROW 22  // pixel offset of the next letters within the char buffer row
+#define MATCHROW 17  // pixel offset of the short code matches within the label row
+#define HOLDROW 26  // pixel offset of the hold bar within the label row, under the matches
+#define HOLDH 3  // pixel height of the hold bar
+#define HOLDMS 40  // ms between updates of the hold bar
+#define SCANY (6 * SIZER)  // top of the scan grid, in place of the code and label rows
+#define SCANW (320 / SCCOLS)  // pixel size of a cell of the scan grid
+#define SCANH (2 * SIZER / SCROWS)
+#define TWSLOTS 16  // slots of the timer wheel, a power of 2
+#define TWTICK 20  // ms per slot of the timer wheel
+#define SCROWS 3  // rows of the scan grid, see scanner
+#define SCCOLS 10  // cells in a row of the scan grid
+#define SCGRP 5  // cells in a group of a row
+#define SCCELLS (SCROWS * SCCOLS)
+#define SCANMS 1200  // ms per scan step at first
+#define SCANMIN 300
+#define SCANMAX 3000
+#define SCLOOPS 2  // passes of a group with no press before going back to the rows
 #define MAXSCODE_TXT 80
+#ifndef SCODESD
+#define SCODESD 0  // 1 - leave short code phrases on the SD card, see scodes
+#endif
+#define SCACHE 4  // phrases cached in RAM when they are left on the card
+#define SCMAXN 16383  // most short codes, so the hash has at most 2^15 slots
+#define SCMAXMEM 0xFFFFUL  // largest block scodes::reserve asks for (16 bit size_t on AVR)
 #define MAXWORD_TXT 200
-#define MAXWORDS 40
+#define MAXWORDS 40  // words kept in message_stk
+#define MSGBUF 256  // bytes of message text kept in message_stk
+#define NBTN 4  // buttons sampled by the timer interrupt
+#define EDGEQ 16  // button edges queued, a power of 2
+#define NGEST 4  // gestures per button, see gestures
+#define GROWS (NBTN + NBTN * (NBTN - 1) / 2)  // buttons, then 2 button chords
+#define DBLTAP 300  // ms after a tap to wait for a second one
+#define RPTMS 400  // ms between repeats of a held button
+#define LPBIN 50  // ms per bin of the press length histogram, see lptuner
+#define LPBINS 32  // bins, the last one holds all longer presses
+#define LPMIN 40  // presses counted before a Long Press is suggested
+#define LPMINC 5  // presses needed on each side of it
+#define LPUNDO 2000  // ms after a long press in which a Delete undoes it
+#define EMICBUF 1000  // text sent in one EMIC 2 say command (its input buffer is 1023)
+#define EMICWAIT 60000  // ms to wait for the EMIC 2's ':' before taking it as lost
 #define MAXWORD 15
-#define MAXMCODES 52
-#define MAXSCODES 40
 #define NPARMS 6
 #define BUFSZ 1000
 #define BUFMCODE 1000
@@ -42,8 +80,14 @@ any lines above THIS line.
 #define PRVC 2
 #define PRFN 3
 #define CODE "CODE.CSV"
+#define CODEBIN "CODE.BIN"
+#define BINMAGIC 0x474D  // "MG"
+#define BINVERSION 5
+#define BINSD 1  // CodeBinHdr flags: phrases left on the SD card
+#define BINBLOCK 64  // bytes read per block while checking CODE.CSV
+#define BINSECTS 7  // number of table sections in CODE.BIN
 #define USR_PARM "USR_PARM.CSV"
-#define DEBOUNCEDELAY 50 
+#define DEBTICKS 2  // timer ticks (about 1 ms each) between debounce samples
 #define BUFFPIXEL 20
 #define LONGPRESS 500
 #define SIZEC 17
@@ -58,31 +102,92 @@ any lines above THIS line.
 #define MODE_PARM 4
 
 // morse codes 
+// mtab is indexed directly by the packed code of a dit/dah sequence:
+// a leading 1 bit followed by one bit per element, dit=0 and dah=1
+// eg, A (.-) is 0b101 = 5, B (-...) is 0b11000 = 24
+// the table is also a tree: the children of code c are 2c (dit) and 2c+1 (dah)
+// codes loaded from the SD card overlay the built-in table in m2g_codes.h
 class mcodes {
 	public:
-	long mkey[MAXMCODES];
-	char mval[MAXMCODES];
+	char mtab[MTABSZ];
+	unsigned char mlive[MTABSZ / 8]; // bit set if an SD code exists at or below c
 	int cnt;
         mcodes();
 	int loadcode(char*);
-	int sortcode();
-	int getcode(long, char *);
+	int getcode(int, char *);
         int dumpcodes (char *); // for testing
-        
-        private:
-        void q_sort(long*, char*, int, int); 
+        int packcode(char *); // CODE.CSV key, eg, 2111, to packed code
+        char val(int); // value of code c, SD then built-in, 0 if none
+        int live(int); // any code at or below c?
+        int reach(int, char *, int); // chars reachable below c, shortest first
+};
+
+// incremental decoder -- cursor into the mcodes tree, moved O(1) per dit/dah
+class mdecoder {
+  public:
+    int cur; // packed code of the elements entered so far
+    mdecoder();
+    int clear();
+    int push(int); // follow a dit (1) or dah (2)
+    int pop(); // back up one element
+    int match(mcodes &, char *); // exact match at the cursor
+    int reach(mcodes &, char *, int); // possible next letters
 };
 
 // short codes 
+// codes loaded from the SD card are searched before the built-in ones.
+// both sets are found through an open addressing hash of the 2 char key
+// (index + 1 in each slot, 0 if empty), so lookup is constant time.
+// the SD codes live in one block, allocated once by reserve and sized
+// from CODE.CSV: the values are packed end to end in sarena.
+// in sd mode only the keys are kept: soff is the value's byte offset in
+// CODE.CSV, read through sread on demand into a small LRU cache
 class scodes {
 	public:
-	char skey[MAXSCODES][10];
-	char sval[MAXSCODES][MAXSCODE_TXT];
-	int cnt;
+	uint32_t *soff;  // offset of the value in sarena, or in CODE.CSV
+	uint16_t *skey;  // key chars, first char in the high byte
+	uint16_t *shash; // 2^hbits hash slots
+	unsigned char *slen; // length of the value
+	char *sarena;  // values, without terminators
+	int cnt;  // codes loaded
+	int cap;  // codes reserved
+	int hbits;
+	uint16_t aused;  // arena bytes used
+	uint16_t asize;  // arena bytes reserved
+	int sd;  // values left on the SD card
+	int (*sread)(uint32_t, char *, int);  // read a value from CODE.CSV
+	uint16_t ckey[SCACHE];  // cached keys, 0 if empty
+	uint16_t cuse[SCACHE];  // when each was last used
+	uint16_t ctick;
+	char *cval;  // SCACHE values of MAXSCODE_TXT bytes
         scodes();
-	int loadcode(char *);
-	int sortcode();
+	int reserve(int, uint32_t, int); // room for n codes, their values, sd mode
+	int clear(); // free the block
+	int loadcode(char *, uint32_t); // line of CODE.CSV and its offset
+	int sortcode(); // sort by key and index, after the last loadcode
+	int index(); // build shash
 	int getcode(char *, char *);
+	int getdefault(char *, char *); // built-in short codes only
+	int prefix(char *, char *, char *); // codes whose key starts with k
+	int nth(int, char *); // key of the nth code, in key order
+
+	private:
+	int getcached(int, char *, int); // value of code i, from the card if rd
+	int lower(uint16_t);
+};
+
+// sizes the short code tables before CODE.CSV is loaded:
+// feed the file through add() in blocks, then done(), then reserve
+class scount {
+  public:
+    int lines;  // scode lines
+    uint32_t bytes;  // value bytes on those lines
+    scount();
+    int add(char *, int);
+    int done();
+  private:
+    int col, field, len;  // position in the current line
+    char scode;
 };
 
 // parameter codes 
@@ -102,12 +207,13 @@ class char_stk {
   public:
     int ditdah[MAXDD]; // stack of dit and dahs
     int ptr; // pointer to top of ditdah stack
+    mdecoder dec; // decoder cursor, follows push and pop
     char_stk();
     int push(int); // push a ditdah  
     int pop(); // pop last ditdah
     int clear(); // clear stack
     int size(); // get value of ptr
-    long get_charval(int &, int *); // return character value, eg, 12 or 2121, value of ptr and ditdah array
+    int get_charval(int &, int *); // return packed code, value of ptr and ditdah array
 };
 
 // word class -- stack of characters that make up a single word
@@ -124,16 +230,252 @@ class word_stk {
 }; 
 
 // message class - stack of words that display on the screen
+// the words are kept end to end in a fixed ring buffer, no heap is used.
+// when MAXWORDS words or MSGBUF bytes are reached, the oldest words
+// are dropped to make room for the new one.
+// each word is followed by a space, so the ring is also the text to speak
 class message_stk {
   public:
-      char **msg;  // array of char 
-      int ptr; 
+      char buf[MSGBUF];  // words with spaces, wrapping round
+      int off[MAXWORDS];  // ring of word starts in buf
+      unsigned char len[MAXWORDS];  // and their lengths with the space
+      int first;  // oldest word in off
+      int head;  // next free byte in buf
+      int used;  // bytes in buf
+      int ptr;  // number of words
+      long drop;  // bytes dropped from the front since clear
       message_stk();
       int clear();
       int push(char *);
       int pop(char *); 
       int get_msg(int, char *);
       int get_ptr(); 
+      int chunk(int, int); // text from a byte position, up to a word end
+      char at(int); // byte of the text
+};
+
+// debounces up to 8 switches at once (make swbits uint16_t for 16): each
+// has a 2 bit counter, kept as bit planes cnt0 and cnt1, of the samples in
+// a row that differ from its debounced state. The state flips on the 4th
+// such sample; any sample that agrees resets the count
+typedef uint8_t swbits;
+class debouncer {
+  public:
+     swbits state;  // debounced switches, 1 - open (pulled high)
+     swbits cnt0, cnt1;
+     debouncer();
+     swbits update(swbits); // take a sample, return the switches that flipped
+};
+
+// button edge, timed by the interrupt that samples the buttons
+struct BtnEdge {
+     unsigned char btn;  // 0 - 3, for buttons 1 - 4
+     unsigned char down;  // 1 pressed, 0 released
+     unsigned long t;  // micros() at the edge
+};
+
+// queue of button edges from the sampling interrupt (the only producer)
+// to loop() (the only consumer). head is only written by put and tail
+// only by get, both single bytes, so no locking is needed
+class edge_q {
+  public:
+     volatile BtnEdge q[EDGEQ];
+     volatile unsigned char head;  // next edge to put
+     volatile unsigned char tail;  // next edge to get
+     edge_q();
+     int put(int, int, unsigned long); // in the interrupt, 0 if full
+     int get(BtnEdge &); // in loop, 0 if empty
+};
+
+// gestures, the columns of gestures::gtab
+#define G_TAP 0
+#define G_LONG 1  // released after LongPress
+#define G_DOUBLE 2  // second tap within DBLTAP
+#define G_REPEAT 3  // held past LongPress, then every RPTMS
+
+// actions of the gestures
+#define A_NONE 0
+#define A_DIT 1
+#define A_DAH 2
+#define A_ENTER 3
+#define A_DELETE 4
+#define A_SPACE 5
+#define A_SPEAK 6
+#define A_BKSP 7
+#define A_CLEAR 8
+
+// gesture recognizer -- turns button edges into actions through gtab,
+// one row per button and one per 2 button chord. Built-in rows are set
+// by clear, gcode lines in CODE.CSV replace them:
+//   gcode,<button or chord, eg 3 or 12>,<tap|long|double|repeat>,<action>
+// a tap only waits for a possible second tap, and a held button only
+// repeats, if the table has an action for that. A press held past
+// LongPress on a button (or chord) with no long action is a tap, so slow
+// presses still work. Two buttons down at once are a chord only if the
+// table has a row for them
+class gestures {
+  public:
+     unsigned char gtab[GROWS][NGEST];  // action of each gesture
+     unsigned char st[NBTN];  // state of each button
+     unsigned long tdown[NBTN];  // micros() of the press
+     unsigned long tnext[NBTN];  // end of the double tap wait, next repeat
+     unsigned char crow;  // row of the chord in progress
+     unsigned char clong;  // a button of the chord was held long
+     unsigned char pend;  // bit set for each button whose tap was ended by another press
+     gestures();
+     int clear();
+     int loadcode(char *);
+     int feed(BtnEdge &, int); // an edge and LongPress, returns an action
+     int poll(unsigned long); // action due by now, if any
+     unsigned long held(unsigned long); // micros the oldest press that can be long has been held
+
+  private:
+     int row(int, int);
+     int due(); // oldest pending tap
+};
+
+// iambic keyer -- in keyer mode buttons 1 and 2 are paddles: holding one
+// sends dits or dahs over and over at the set speed, holding both sends
+// them in turn. In mode B one more element, the other one, is sent when a
+// squeeze is let go. Run by the button sampling interrupt; the elements go
+// to loop() through out
+#define K_OFF 0  // buttons 1 and 2 are straight keys, see gestures
+#define K_IAMBIC_A 1
+#define K_IAMBIC_B 2
+#define KEYWPM 12  // words per minute until one is set
+class keyer {
+  public:
+     unsigned char mode;  // K_OFF, K_IAMBIC_A or K_IAMBIC_B
+     unsigned char unit;  // ms of a dit, 1200 / words per minute
+     edge_q out;  // elements sent, btn is A_DIT or A_DAH and t its start
+     keyer();
+     int set(int, int); // mode and words per minute
+     void tick(swbits, unsigned long); // in the interrupt: paddles down (bit 0
+                                       // dit, bit 1 dah) and micros()
+
+  private:
+     unsigned long tend;  // micros() at the end of the element and its space
+     unsigned char busy;  // an element is being sent
+     unsigned char last;  // the element sent last
+     unsigned char mem;  // the other paddle was pressed during it
+};
+
+// learns the Long Press from how long the buttons that have both a tap
+// and a long press are held. The threshold suggested is the one that best
+// separates the short and long presses in the histogram (Otsu's method).
+class lptuner {
+  public:
+     unsigned char hist[LPBINS];  // presses by length, halved when a bin fills
+     int n;  // presses in hist
+     int misfire;  // long presses undone by a Delete right after
+     lptuner();
+     int clear();
+     int edge(gestures &, BtnEdge &, int); // call before gestures::feed
+     int action(int, unsigned long); // each action and millis()
+     int suggest(int); // Long Press in ms, -1 if not enough presses yet
+
+  private:
+     unsigned char waslong;  // the last press counted was long
+     unsigned long tlong;  // millis() of the last long press action, 0 none
+     unsigned char longact;  // the action of that long press
+};
+
+// hashed timer wheel -- a timer due in n ticks goes in the slot n ahead
+// of the current one, with the number of whole turns still to go. Arm and
+// cancel are O(1) (each slot is a doubly linked list); each tick only
+// looks at the timers in one slot
+#define T_LETTER 0  // auto commit of the letter keyed in
+#define T_WORD 1  // auto commit of the word
+#define NTIMER 2
+class twheel {
+  public:
+     twheel();
+     int arm(int, unsigned, unsigned long); // timer, ms from now and millis()
+     int cancel(int);
+     int run(unsigned long); // millis(), returns a bit for each timer that expired
+
+  private:
+     unsigned long tnow;  // millis() of the current slot
+     unsigned char cur;  // current slot
+     unsigned char armed;  // timers on the wheel
+     unsigned char head[TWSLOTS];  // first timer + 1 in each slot, 0 none
+     unsigned char next[NTIMER], prev[NTIMER];  // timer + 1, 0 none
+     unsigned char slot[NTIMER];  // slot of each timer, TWSLOTS if not armed
+     unsigned int turns[NTIMER];  // turns of the wheel to go
+};
+
+// single switch scanning -- the rows of the grid are highlighted in turn,
+// then the groups of the row pressed on, then the cells of the group; a
+// press on a cell selects it. Any press will do, its length and timing do
+// not matter. rank orders the cells by the steps it takes to reach them,
+// so the most used items go in the cells of low rank. The step gets
+// faster after selections made on the first pass of each level and slower
+// after corrections (adapt) and after passes with no press
+class scanner {
+  public:
+     unsigned char rank[SCCELLS];  // rank of each cell, 0 is reached first
+     unsigned char level;  // 0 rows, 1 groups, 2 cells
+     unsigned char at[3];  // highlighted row, group in it, cell in that
+     unsigned char loops;  // passes of this level with no press
+     unsigned char clean;  // every level so far was pressed on its first pass
+     unsigned int rate;  // ms per step
+     unsigned long tnext;  // millis() of the next step
+     scanner();
+     int start(unsigned long); // back to the rows
+     int step(unsigned long); // 1 if the highlight moved
+     int press(unsigned long); // the cell selected, -1 if a level down
+     int first(); // highlighted cells
+     int last();
+     int adapt(int); // 1 faster, 0 slower
+
+  private:
+     int count(); // rows, groups or cells at this level
+};
+
+// retained text grid -- the text on the screen is kept here a cell (char
+// and attributes) at a time. The sketch writes lines of text into the grid
+// and ShowGrid draws only the cells that changed since they were drawn, so
+// a keystroke costs the few glyphs it changes, not whole rows. Each line
+// is a row of cells of one text size and pitch. A size 3 glyph is wider
+// than its cell and the dits and dahs reach into the next letters, so
+// drawing a cell also marks the cells it overlaps to be drawn after it.
+// The marked cells are the queue of drawing still to do: a cell written
+// again before it is drawn is drawn once, with what it holds by then
+#define G_MSG 0  // message rows 0-4
+#define MSGJUMP 3  // rows a full message area scrolls up at once
+#define G_WORD 5  // "OK>", the word and the cursor
+#define G_DITS 6  // dits and dahs
+#define G_CHAR 7  // the letter they make
+#define G_CAND 8  // possible next letters, small print under the dits and dahs
+#define G_LAB3 9  // label of the Enter button
+#define G_LAB4 10  // label of the Delete button
+#define G_MATCH 11  // short code matches, small print under the labels
+#define GLINES 12
+#define GCHAR 7  // chars of the letter line, "Speak" is the longest
+#define GMATCH 47  // chars of small print in the match line
+#define GCELLS (6 * NCOL + MAXDD + GCHAR + MAXCAND + 11 + 12 + GMATCH)
+#define GA_DIM 1  // attribute: grey, for a label that does nothing now
+#define GRIDUS 2000  // us of drawing from the grid per pass of loop, see ShowGrid
+class textgrid {
+  public:
+     unsigned char x[GLINES], y[GLINES];  // pixel position of the first cell
+     unsigned char pitch[GLINES], size[GLINES];  // cell width, text size
+     unsigned char n[GLINES], base[GLINES];  // cells, first one in ch and at
+     char ch[GCELLS];  // ' ' is blank
+     char at[GCELLS];  // GA_ attributes
+     int pend;  // cells waiting to be drawn
+     textgrid();
+     int put(int, int, char, char); // line, cell, char, attributes; 1 if changed
+     int text(int, int, const char *, char); // from a cell, blanks the rest; cells changed
+     int redraw(int); // draw the line again, after something else drew over it
+     int scroll(int, int, int); // move lines up some, blanks the last ones; cells changed
+     int next(int, int *, int *, int *); // cells to draw before a line: line, cell, count
+
+  private:
+     unsigned char dirty[(GCELLS + 7) / 8];  // cells to draw
+     int setup(int, int, int, int, int, int, int);
+     int mark(int); // mark a non-blank cell, 1 if it was not marked
+     int spill(int, int, int); // mark what cells of a line drawn overlap
 };
 
 // EEPROM data
@@ -141,6 +483,27 @@ struct EEPromData {
      int ckvalue;  // should be 12345
      int LongPress; // length of a long press (300 - 1500)
      int Voice; // voice number to use (0 - 8)
-     int v[10];  // reserved
+     int v[10];  // v[0] learned Long Press, v[1] apply it, v[2] misfires,
+                 // v[3] keyer mode, v[4] keyer words per minute,
+                 // v[5] letter auto commit ms, v[6] word auto commit ms,
+                 // v[7] scan ms per step, v[8] scanning on, rest reserved
 };
 
+// CODE.BIN -- compiled image of CODE.CSV, written by ReadDataFile after a
+// successful parse or offline by tools/m2gc.cpp. The header is followed by
+// mcodes::mtab, mcodes::mlive, then scodes::skey, soff, slen and the used
+// part of sarena (see codebin_map). scodes::shash is rebuilt on loading.
+// with BINSD set there is no arena and soff holds CODE.CSV offsets.
+// gestures::gtab comes last.
+struct CodeBinHdr {
+     uint16_t magic;    // BINMAGIC
+     uint16_t version;  // BINVERSION, bumped when the layout changes
+     uint32_t srcsize;  // size of the CODE.CSV this image was built from
+     uint32_t srccrc;   // CRC-32 of that CODE.CSV
+     int16_t mcnt;      // mcodes::cnt
+     int16_t scnt;      // scodes::cnt
+     int16_t pvc;       // pcodes::pvc
+     uint16_t sbytes;   // scodes::aused
+     uint16_t flags;    // BINSD
+     uint16_t reserved;
+};
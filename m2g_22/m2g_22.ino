@@ -58,13 +58,61 @@ any lines above THIS line:
     0.3 seconds to 1.5 seconds, respectively. This new value is saved for the next reboot. 
   - Added Voice Param user contral. By entering one of the 9 codes (:V0 ot :V8) the user can change the voice of the Text-to-Speech module.
     This new value is saved for the next reboot.   
+
+Release 2.3 (in development)
+  - Possible next letters are shown under the dits and dahs as a code is keyed in
+  - CODE.CSV is compiled to CODE.BIN on first boot (or on a PC with tools/m2gc.cpp). Later boots load
+    CODE.BIN directly while CODE.CSV is unchanged. Boot phase timings are printed on the serial monitor.
+  - Built-in code tables (m2g_codes.h, generated from CODE.CSV with tools/m2gc.cpp -h) are kept in flash.
+    Codes on the SD card are used in addition to them, and the M2G still works with no card.
+  - Short code phrases can be left on the SD card (SCODESD in m2g.h, or when they do not fit in RAM).
+    Only their keys are kept in RAM, with the last few phrases used cached.
+  - While a ':' word is typed, the number of short codes that start with it and the first one are shown
+    under the labels.
+  - The message words are kept in a fixed ring buffer instead of the heap; when it is full the oldest
+    words are dropped.
+  - Say It has no length limit. The message is sent to the EMIC 2 in chunks that end at a word, each
+    one after the EMIC 2 has finished the one before. Each loop pass sends only what fits in the serial
+    buffer, so the buttons are not held up while it goes out. Say It while speaking starts over once the
+    EMIC 2 has finished the part already sent.
+  - The buttons are sampled by a timer interrupt that queues each press and release with its time, so
+    press lengths are exact however long the screen or card takes, and each button is timed on its own.
+    All buttons are debounced together in the interrupt (a change must hold for 4 samples, 2 ms apart).
+  - What each button does is set by a gesture table (tap, long press, double tap, hold to repeat and
+    2 button chords). gcode lines in CODE.CSV change it, eg "gcode,3,double,speak".
+  - The Long Press is learned from how long the buttons are held. :LS shows the learned value and the
+    number of misfires (a long press undone by a Delete right after). :LY uses it from then on, adjusted
+    at the end of each word, and :LN stops. It is kept in the EEPROM.
+  - Iambic keyer: after :KA (mode A) or :KB (mode B) buttons 1 and 2 are paddles. Holding one sends
+    dits or dahs over and over, holding both sends them in turn. :K1 - :K9 set the speed (5 - 45 words
+    per minute) and :KS turns the keyer off. Enter and Delete are then on buttons 3 and 4.
+  - A bar under the labels grows while a button is held and turns green once the press is long.
+  - Optional auto commit: after :A1 - :A9 the letter is entered when no dit or dah has come for 0.2 -
+    1.8 seconds, and a space after a further 0.5 - 4.5 seconds set by :W1 - :W9 (1.5 at first). :A0
+    turns it off. The delays are run by a small timer wheel.
+  - Single switch scanning (:SC): a grid of letters and short codes takes the place of the code and
+    label rows. Its rows, then groups, then cells are highlighted in turn and any button selects. The
+    most used letters are reached first. The scan gets faster after quick selections and slower after
+    corrections; the X cell on the short code page turns it off.
+  - Screen fills, lines and the start-up picture are sent to the TFT in blocks (writeColor and writePixels
+    in Adafruit_ILI9341) instead of a byte at a time; the times of a fillScreen and of a fillRect of a
+    row are printed at start up.
+  - Text is drawn a character at a time in one TFT window when it has a background colour, and a run of
+    pixels at a time when it does not (setTextBlit in Adafruit_GFX), instead of a pixel at a time.
+  - The text on the screen is kept in a grid of cells (textgrid); the message, word, code and label rows
+    are written into it and ShowGrid draws only the cells that changed. cls no longer fills the screen.
+  - ShowGrid draws for at most about GRIDUS us each pass of loop and leaves the rest for the next pass, so
+    a long short code on Enter no longer holds up the buttons; the worst pass is printed on Serial.
+    Only the first screen at start up is drawn all at once.
+  - A full message area scrolls up MSGJUMP (3) rows in the text grid instead of showing ".." for 3
+    seconds and clearing; only the cells that change are drawn again. Scrolling a row at a time drew
+    nearly the whole message area again for every new line.
 */
 
 #include <Adafruit_GFX.h>    // Core graphics library
 #include "Adafruit_ILI9341.h" // 2.8" touch screen
 #include <SPI.h>
 #include <SD.h>
-#include <StopWatch.h>
 #include <EEPROM.h>
 #include "m2g.cpp"
 
@@ -94,8 +142,22 @@ word_stk word_s;
 // data structure of message stack
 message_stk message_s;
 
-// stopwatch -- used to time switch press
-StopWatch SW;
+// button edges, queued with their times by the sampling interrupt
+edge_q edges;
+debouncer Debounce;
+
+// button gestures and their actions
+gestures gest;
+
+// press lengths, to learn the Long Press
+lptuner tuner;
+
+// iambic keyer on buttons 1 and 2, when it is turned on
+keyer keys;
+
+// input register and bit of each button, for the interrupt
+volatile uint8_t *BtnReg[NBTN];
+uint8_t BtnBit[NBTN];
 
 // length of a long press (minimum in milliseconds)
 int LongPress;
@@ -103,45 +165,62 @@ int LongPress;
 // voice parm
 int Voice;
 
-// flag that is set if long press done
-int LongPress1, LongPress2, LongPress3;
+// auto commit of letters and words, 0 when off (milliseconds)
+int AutoLetter, AutoWord;
+twheel wheel;
+
+// single switch scanning, see scanner
+scanner scan;
+int ScanMode;  // 1 when scanning
+int ScanPage;  // 0 letters, 1 short codes
+int ScanPend = -1;  // rank of a short code to enter after the word before it
+
+// scan grid items by rank: the letters in order of how often they are used,
+// after the space. '<' backspace, '!' say it, ':' the short code page
+const char scan_items[SCCELLS + 1] PROGMEM = " ETAOIN<SHRDLCUMWFGYPB!VKJXQZ:";
+
+// the text on the screen, see textgrid
+textgrid grid;
+unsigned long GridMax;  // longest pass of ShowGrid (us)
+int GridDeep;  // most cells waiting to be drawn
 
 // pin number can be changed
 const int inPin1 = 41;     // button 1 - dit
-int buttonState1 = HIGH;  // button state - dit
-int lastButtonState1 = HIGH;
-long lastDebounceTime1 = 0;  // the last time pin 1 was toggled
-int readingPin1;  // current reading switch 1
 
 // pin number can be changed
 const int inPin2 = 43;     // button 2 - dah
-int buttonState2 = HIGH;  // button state - dah
-int lastButtonState2 = HIGH;
-long lastDebounceTime2 = 0;  // the last time pin 2 was toggled
-int readingPin2;  // current reading switch 2
 
 // pin number can be changed
 const int inPin3 = 47;     // button 3 - enter
-int buttonState3 = HIGH;  // button state - enter
-int lastButtonState3 = HIGH;
-long lastDebounceTime3 = 0;  // the last time pin 3 was toggled
-int readingPin3;  // current reading switch 3
 short timesPressed3 = 0; // times enter key pressed in a row
 
 // pin number can be changed
 const int inPin4 = 49;     // button 4 - delete
-int buttonState4 = HIGH;  // button state - delete
-int lastButtonState4 = HIGH;
-long lastDebounceTime4 = 0;  // the last time pin 3 was toggled
-int readingPin4;  // current reading switch 4
 short timesPressed4 = 0; // times delete key pressed in a row
 
-const long debounceDelay = DEBOUNCEDELAY;     // delay in milliseconds
 
 // voice param
 int pr_vc = PRVC;
 int pr_fn = PRFN;
 
+// set if the Micro SD card was found
+int SdOk;
+
+// CODE.CSV, kept open when the short code phrases are left on the card
+File CodeFile;
+
+// next byte of the message to send to the EMIC 2, -1 if none, and the
+// end of the say command being sent, -1 while waiting for its ':'.
+// Counted from the start of the message, words dropped by message_s
+// included (see message_stk::drop), so a push does not move them
+long SpeakPos = -1;
+long SpeakEnd = -1;
+
+// commands sent to the EMIC 2 that it has not answered with ':' yet, and
+// millis() of the last one. A say command only starts when this is 0
+int SpeakWait;
+unsigned long SpeakSent;
+
 // EEPROM data 
 int Adr = 0;
 EEPromData Eep;
@@ -154,9 +233,12 @@ void setup()
   char *p;
   int i = 0, j = 0, n = 0, k, r, c;
   int mode;
-  char buf[20], buf1[20];
+  char buf[20], buf1[20], buf2[80];
   int v[NPARMS];
   float f_longPress, f_voice;
+  unsigned long t_boot, t_sd, t_code, t_parm;  // boot phase timings
+  int from = 0;  // where the codes came from, see ReadDataFile
+  unsigned long t_fill, t_rect;  // fillScreen and fillRect timings
 
   // Open serial communications and wait for port to open:
   Serial.begin(9600);
@@ -191,14 +273,18 @@ void setup()
   else {
       LongPress = Eep.LongPress;
       Voice = Eep.Voice; 
+      tuner.misfire = Eep.v[2];
+      keys.set(Eep.v[3], Eep.v[4] ? Eep.v[4] : KEYWPM);
+      AutoLetter = Eep.v[5];
+      AutoWord = Eep.v[6];
+      if (Eep.v[7])
+        scan.rate = Eep.v[7];
+      ScanMode = Eep.v[8];
       sprintf(buf, "Voice: %d, Long Press: %d\n", Voice, LongPress);
       Serial.println(buf);
   }
   sprintf(buf, "N%d\n", Voice); 
-  Serial1.print(buf);
-  Serial1.flush();                 // Flush the receive buffer
-
-  LongPress3 = 0;
+  EmicSend(buf);
 
   // input keys setup
   pinMode(inPin1, INPUT);
@@ -211,51 +297,87 @@ void setup()
   digitalWrite(inPin3, HIGH);
   digitalWrite(inPin4, HIGH);
 
+  // sample the buttons from the Timer0 compare interrupt, see ISR below
+  BtnInit(0, inPin1);
+  BtnInit(1, inPin2);
+  BtnInit(2, inPin3);
+  BtnInit(3, inPin4);
+  OCR0A = 0x80;
+  TIMSK0 |= _BV(OCIE0A);
+
   // for Micro SD
   pinMode(chipSelect, OUTPUT);
 
   // see if the card is present and can be initialized:
-  if (!SD.begin(chipSelect)) {
-    tft.println(F("Card failed, or not present"));
-    // don't do anything more:
-    return;
-  }
+  // without a card the built-in codes in m2g_codes.h are used
+  t_boot = millis();
+  SdOk = SD.begin(chipSelect);
+  if (!SdOk)
+    Serial.println(F("Card failed, or not present - using built-in codes"));
+  t_sd = millis();
 
   // load data file from Google Docs copied onto Micro SD
-  ReadDataFile(CODE);
+  // (or its compiled image CODE.BIN if CODE.CSV is unchanged)
+  scode.sread = ReadScode;
+  if (SdOk)
+    from = ReadDataFile(CODE);
+  t_code = millis();
 
   // load user parameter file if it exists
-  ReadParmFile(USR_PARM);
+  if (SdOk)
+    ReadParmFile(USR_PARM);
+  t_parm = millis();
 
-  // sort the codes
-  mcode.sortcode();
+  sprintf(buf2, "boot: sd %lu ms, codes %lu ms (%s), parm %lu ms", t_sd - t_boot, t_code - t_sd,
+          from == 2 ? CODEBIN : from == 1 ? CODE : "built-in", t_parm - t_code);
+  Serial.println(buf2);
 
   // setup TFT screen
   tft.begin();
+  tft.setTextBlit(true);  // characters in a window or in runs, not pixel by pixel
   tft.setTextColor(ILI9341_BLACK);
   tft.setTextSize(2);  // font param
 
   tft.setRotation(1);
-  bmpDraw("m2g.bmp", 0, 0);
-  delay(2000);
+  if (SdOk) {
+    bmpDraw("m2g.bmp", 0, 0);
+    delay(2000);
+  }
   
+  t_fill = micros();
   tft.fillScreen(0xFFFF);
+  t_fill = micros() - t_fill;
   setcursor(1, -1, 4, 4, &c, &r);
   tft.print(F("M2G Version 2.2"));
+  if (!SdOk) {
+    setcursor(1, -1, 1, 5, &c, &r);
+    tft.print(F("No card - built-in codes"));
+  }
   delay(1000);
 
   f_longPress = (float)LongPress / 1000.0;
   dtostrf(f_longPress, 3, 1, buf1);
   sprintf(buf, "Long Press %s Sec.", buf1); 
   tft.fillScreen(0xFFFF);
+  t_rect = micros();
+  tft.fillRect(0, 0, 320, SIZER, 0xFFFF);  // a row of the grid, white on white
+  t_rect = micros() - t_rect;
+  sprintf(buf2, "fillScreen: %lu us, fillRect 320x%d: %lu us", t_fill, SIZER, t_rect);
+  Serial.println(buf2);
   setcursor(1, -1, 2, 4, &c, &r);
   tft.print(buf);
   delay(1000);
   
-  Serial1.print("S M 2 G Version 2.2\n");
+  EmicSend("S M 2 G Version 2.2\n");
   tft.setTextSize(pr_fn);  // font param
+  tft.fillRect(c, r, strlen(buf) * 12, 16, ILI9341_WHITE);  // the grid only knows what it drew
+  t_boot = micros();
   cls(0);
   show_labels(0, 0);
+  ShowGrid(0);
+  sprintf(buf2, "first screen: %lu us", micros() - t_boot);
+  Serial.println(buf2);
+  ScanDraw(1);
 
 }
 
@@ -263,10 +385,9 @@ void setup()
 void loop() {
 
   char buf[SIZMESG], buf1[SIZMESG];
-  int timebtn1, timebtn2, timebtn3, timebtn4;
-  int Btn1, Btn2, Btn3, Btn4, PushCode, clen, lenmesg, CurRow1, ptr, valLP, valVOZ ;
-  int speakit, speaklen, new_word, csize, lenpword;
-  char speaktxt[MAXWORD_TXT];
+  int act, clen, lenmesg, CurRow1, ptr, valLP, valVOZ ;
+  int speakit, new_word, lenpword, fired, gap;
+  BtnEdge e;
   char pword[SIZPWORD];
   char smesg[SIZMESG];
   char *pword1, *tok;
@@ -274,90 +395,55 @@ void loop() {
   static char s[2] = " ";
   float f_longPress;
 
-  // check button status
-  readingPin1 = digitalRead(inPin1);
-  readingPin2 = digitalRead(inPin2);
-  readingPin3 = digitalRead(inPin3);
-  readingPin4 = digitalRead(inPin4);
-
-  Btn1 = Btn2 = Btn3 = Btn4 = 0;
-  PushCode = 0;
-  LongPress1 = LongPress2 = 0;
-
-  //  Button 1 - 4 Pressed
-  if ((readingPin1 == LOW && lastButtonState1 == HIGH) ||
-      (readingPin2 == LOW && lastButtonState2 == HIGH) ||
-      (readingPin3 == LOW && lastButtonState3 == HIGH) ||
-      (readingPin4 == LOW && lastButtonState4 == HIGH)) {
-    SW.reset(); // reset timer
-    SW.start(); // start timer
-  }
-
-  // button 1 Released
-  if (readingPin1 == HIGH && lastButtonState1 == LOW) {
-    timebtn1 = SW.elapsed();
-
-    if (timebtn1 > DEBOUNCEDELAY) {
-      SW.stop();
-      if (timebtn1 > LongPress)
-        LongPress1 = 1;
-      else {
-        PushCode = 1;  // dot
-        Btn1++;
-      }
-    }
-    LongPress3 = 0;
-  }
-
-  // button 2 Released
-  if (readingPin2 == HIGH && lastButtonState2 == LOW) {
-    timebtn2 = SW.elapsed();
-
-    if (timebtn2 > DEBOUNCEDELAY) {
-      SW.stop();
-      if (timebtn2 > LongPress)
-        LongPress2 = 1;
-      else {
-        PushCode = 2;  // dash
-        Btn2++;
-      }
+  // keep a long message going to the EMIC 2
+  SpeakNext();
+
+  // grow the hold bar while a button is held
+  show_hold();
+
+  // next action from the button gestures, see gestures and gcode lines.
+  // press times are from the interrupt's timestamps, so slow drawing here
+  // does not skew them
+  // the keyer's elements come first, they were sent before any edge still
+  // queued was seen
+  if (ScanMode)
+    act = ScanInput();
+  else if (keys.out.get(e))
+    act = e.btn;
+  else
+    act = gest.poll(micros());
+  while (!ScanMode && act == A_NONE && edges.get(e)) {
+    if (e.down) {  // no auto commit while a button is pressed
+      wheel.cancel(T_LETTER);
+      wheel.cancel(T_WORD);
     }
-    LongPress3 = 0;
+    if (keys.mode != K_OFF && e.btn < 2)  // paddles, see keyer
+      continue;
+    tuner.edge(gest, e, LongPress);
+    act = gest.feed(e, LongPress);
   }
-
-  // button 3 Released
-  if (readingPin3 == HIGH && lastButtonState3 == LOW) {
-    timebtn3 = SW.elapsed();
-
-    if (timebtn3 > DEBOUNCEDELAY) {
-      SW.stop();
-      if (timebtn3 > LongPress && LongPress3 == 0) {
-        LongPress3 = 1;
-      }
-      else if (timebtn3 > LongPress && LongPress3 == 1) {
-        LongPress3 = 0;
-      }
-      else {
-        Btn3++;
-        LongPress3 = 0;
-      }
-    }
+  if (act != A_NONE)
+    tuner.action(act, millis());
+
+  // auto commit: the letter is entered once no dit or dah has come for
+  // AutoLetter, then a space once nothing more has come for AutoWord
+  if (act == A_NONE) {
+    fired = wheel.run(millis());
+    if (fired & (1 << T_LETTER))
+      act = A_ENTER;
+    else if (fired & (1 << T_WORD))
+      act = A_SPACE;
   }
 
-  // button 4 Released
-  if (readingPin4 == HIGH && lastButtonState4 == LOW) {
-    timebtn4 = SW.elapsed();
-
-    if (timebtn4 > DEBOUNCEDELAY) {
-      SW.stop();
-      Btn4++;
-    }
-    LongPress3 = 0;
+  // a space is the same as keying 'p' and then Enter
+  if (act == A_SPACE) {
+    inp_ch = 'p';
+    act = A_ENTER;
   }
 
   // dit or dah pressed - show results at bottom of screen
-  if (Btn1 || Btn2) {
-    clen = char_s.push(PushCode);
+  if (act == A_DIT || act == A_DAH) {
+    clen = char_s.push(act == A_DIT ? 1 : 2);
     if (clen <= MAXDD) 
        inp_ch = show_cbuf();
     timesPressed3 = 0;
@@ -365,7 +451,7 @@ void loop() {
     show_labels(timesPressed3, timesPressed4);
   }
 
-  if (Btn3 || LongPress1) {
+  if (act == A_ENTER) {
     timesPressed4 = 0;
     if (inp_ch == 'p' or timesPressed3 == 1) { // insert a space
       new_word = 1; // set new word flag
@@ -379,6 +465,13 @@ void loop() {
         pword1 = pword + (char) 1;
         memset(buf, 0, SIZMESG); 
         if (lenpword == 3) { // it might be a Long Press param
+           LongPressTune(pword1, buf);
+           KeyerLookup(pword1, buf);
+           AutoLookup(pword1, buf);
+           if (strcmp(pword1, "SC") == 0) {
+              ScanOn(1);
+              sprintf(buf, "Scanning on");
+           }
            valLP = LongPressLookup(pword1); 
            if (valLP > 0) { // it was a Long Press param -- update global variable, EEPROM, and display new value
               LongPress = valLP;
@@ -392,8 +485,8 @@ void loop() {
               Voice = valVOZ;
               EepUpdate(2, Voice);
               sprintf(buf1, "N%d\n", Voice);
-              Serial1.print(buf1);
-              Serial1.flush();                 // Flush the receive buffer
+              SpeakClose();  // not in the middle of a say command
+              EmicSend(buf1);
               sprintf(buf, "Voice Code is %d", Voice);
            }
         }
@@ -425,17 +518,15 @@ void loop() {
       // clear the word row
       cls(2);
 
+      // keep what has been learned of the Long Press and the scan rate
+      LearnLongPress();
+      if (ScanMode && abs((int) scan.rate - Eep.v[7]) > Eep.v[7] / 10)
+        EepUpdate(10, scan.rate);
+
       timesPressed3 = 2;
     }
     else if (timesPressed3 == 2 || inp_ch == '.' || inp_ch == 's') {  // enter pressed 3 times - speak
-      memset(speaktxt, 0, MAXWORD_TXT); 
-      speaklen = GetMessage(speaktxt);
-      if (speaklen) {
-        sprintf(buf, "S%s\n", speaktxt);
-        Serial1.print(buf);
-        Serial1.flush();                 // Flush the receive buffer
-        Serial.println(buf); 
-      }
+      SayMessage();
       timesPressed3 = 0;
     }
     else if (inp_ch == 'b') {  // special case - backspace
@@ -460,7 +551,7 @@ void loop() {
     show_labels(timesPressed3, timesPressed4);
   }
 
-  if (Btn4 || LongPress2) {
+  if (act == A_DELETE) {
     timesPressed3 = 1;    // changed 0 to 1 --- debug
     if (timesPressed4 == 0)  // delete character
       timesPressed4 = 1;
@@ -478,20 +569,98 @@ void loop() {
     show_labels(timesPressed3, timesPressed4);
   }
 
-  lastButtonState1 = readingPin1;
-  lastButtonState2 = readingPin2;
-  lastButtonState3 = readingPin3;
-  lastButtonState4 = readingPin4;
+  // the other special codes, when a gesture is set up for them
+  if (act == A_SPEAK || act == A_BKSP || act == A_CLEAR) {
+    if (act == A_SPEAK) {
+      SayMessage();
+      timesPressed3 = 0;
+    }
+    else if (act == A_BKSP) {
+      backspace();
+      timesPressed3 = 1;
+    }
+    else {
+      cls(0);
+      timesPressed3 = 0;
+    }
+    timesPressed4 = 0;
+    inp_ch = -1;
+    char_s.clear();
+    clr_buf(3);
+    show_labels(timesPressed3, timesPressed4);
+  }
+
+  // set the auto commit timers for what was just done
+  if (act != A_NONE && AutoLetter) {
+    if (act == A_DIT || act == A_DAH) {
+      gap = AutoLetter;
+      if (keys.mode != K_OFF)  // keyer elements come at their start
+        gap += (act == A_DIT ? 2 : 4) * keys.unit;
+      wheel.arm(T_LETTER, gap, millis());
+      wheel.cancel(T_WORD);
+    }
+    else {
+      wheel.cancel(T_LETTER);
+      if (timesPressed3 == 1 && AutoWord && word_s.ptr > 0)  // a letter was entered
+        wheel.arm(T_WORD, AutoWord, millis());
+      else
+        wheel.cancel(T_WORD);
+    }
+  }
+
+  // draw some of what has changed, the rest on the next passes
+  ShowGrid(GRIDUS);
 }
 
 ////////////////////////// End of Loop ///////////////////////////////////////////
 // begin functions
 
+// input register and bit of button b on pin
+void BtnInit(int b, int pin) {
+  BtnReg[b] = portInputRegister(digitalPinToPort(pin));
+  BtnBit[b] = digitalPinToBitMask(pin);
+}
+
+// sample the buttons every DEBTICKS ms, on the Timer0 compare match that
+// runs beside millis(). Pins 41/43/47/49 have no pin change interrupt on
+// the Mega, so they are read here. All of them are debounced at once by
+// Debounce and each clean press or release is queued with its time.
+// An edge that does not fit in the queue is undone and found again later
+ISR(TIMER0_COMPA_vect) {
+  static uint8_t tick;
+  swbits sample = 0, flip;
+  uint8_t b;
+  unsigned long t;
+
+  if (++tick < DEBTICKS)
+    return;
+  tick = 0;
+
+  for (b = 0; b < NBTN; b++)
+    if (*BtnReg[b] & BtnBit[b])
+      sample |= 1 << b;
+
+  flip = Debounce.update(sample);
+  t = micros();
+  if (flip) {
+    for (b = 0; b < NBTN; b++)
+      if ((flip & (1 << b)) && !edges.put(b, !((Debounce.state >> b) & 1), t))
+        Debounce.state ^= 1 << b;
+  }
+  keys.tick(~Debounce.state & 3, t);
+}
+
 // read datafile into classes
 // fn - file name
-void ReadDataFile(char *fn) {
+// CODE.CSV is only parsed if CODE.BIN is missing or was built from a
+// different CODE.CSV. After a parse CODE.BIN is rewritten for next boot.
+// returns where the codes came from: 2 CODE.BIN, 1 CODE.CSV, 0 neither
+int ReadDataFile(char *fn) {
   char str[100];
   char *p;
+  uint32_t srcsize, srccrc, pos;
+  scount sc;
+  int n, from = 0;
 
   char buf[100];
   sprintf(buf, "file %s", fn);
@@ -500,26 +669,175 @@ void ReadDataFile(char *fn) {
   File dataFile = SD.open(fn);
   if (dataFile) {
 
-    while ( SD_fgets (str, 100, dataFile) != NULL ) {
+    // size and CRC of CODE.CSV, and room needed for its short codes
+    srcsize = dataFile.size();
+    srccrc = 0;
+    while ((n = dataFile.read(str, BINBLOCK)) > 0) {
+      srccrc = crc32_update(srccrc, (unsigned char *)str, n);
+      sc.add(str, n);
+    }
+    sc.done();
 
-      // remove newline
-      if ((p = strchr(str, '\n')) != NULL)
-        * p = '\0';
+    if (ReadCodeBin(CODEBIN, srcsize, srccrc)) {
+      Serial.println(F("codes loaded from " CODEBIN));
+      ShowArena();
+      from = 2;
+    }
+    else {
+      dataFile.seek(0);
 
-      switch (str[0]) {
-        case 'm':
-          mcode.loadcode(str);  // load the morse code
-          break;
-        case 's':
-          scode.loadcode(str);  // load the short code
-          break;
-        case 'p':
-          pcode.loadcode(str);  // load the parameter code
+      // phrases go on the card if asked for, or if they do not fit in RAM
+      if (scode.reserve(sc.lines, sc.bytes, SCODESD) < 0 &&
+          scode.reserve(sc.lines, 0, 1) < 0)
+        Serial.println(F("no room for short codes"));
+
+      while (1) {
+        pos = dataFile.position();
+        if (SD_fgets (str, 100, dataFile) == NULL)
           break;
+
+        // remove newline
+        if ((p = strchr(str, '\n')) != NULL)
+          * p = '\0';
+
+        switch (str[0]) {
+          case 'm':
+            mcode.loadcode(str);  // load the morse code
+            break;
+          case 's':
+            scode.loadcode(str, pos);  // load the short code
+            break;
+          case 'p':
+            pcode.loadcode(str);  // load the parameter code
+            break;
+          case 'g':
+            if (gest.loadcode(str) < 0) {  // load the gesture code
+              Serial.print(F("gesture code not loaded: "));
+              Serial.println(str);
+            }
+            break;
+        }
       }
+      scode.sortcode();  // index the short codes
+      ShowArena();
+      WriteCodeBin(CODEBIN, srcsize, srccrc);
+      from = 1;
+    }
+
+    if (scode.sd && scode.cnt > 0) {
+      CodeFile = dataFile;  // read by ReadScode
+      ShowLookup();
+      return from;
     }
   }
   dataFile.close();
+  return from;
+}
+
+// report short code memory use on Serial
+void ShowArena() {
+  char buf[80];
+
+  if (scode.sd)
+    sprintf(buf, "short codes: %d on card, cache %d, %u bytes in all", scode.cnt,
+            SCACHE, scode.cap * 7 + (2 << scode.hbits) + SCACHE * MAXSCODE_TXT);
+  else
+    sprintf(buf, "short codes: %d, arena %u of %u bytes, %u bytes in all", scode.cnt,
+            scode.aused, scode.asize, scode.cap * 7 + (2 << scode.hbits) + scode.asize);
+  Serial.println(buf);
+}
+
+// time a lookup of the first short code left on the card, from the card
+// (cold) and again from the cache (warm)
+void ShowLookup() {
+  char k[3], v[MAXSCODE_TXT];
+  char buf[60];
+  unsigned long t0, t1, t2;
+
+  k[0] = scode.skey[0] >> 8;
+  k[1] = scode.skey[0] & 0xff;
+  k[2] = 0;
+  t0 = micros();
+  scode.getcode(k, v);
+  t1 = micros();
+  scode.getcode(k, v);
+  t2 = micros();
+  sprintf(buf, "short code lookup: cold %lu us, warm %lu us", t1 - t0, t2 - t1);
+  Serial.println(buf);
+}
+
+// read n bytes of a short code value at pos in CODE.CSV, see scodes::sread
+int ReadScode(uint32_t pos, char *v, int n) {
+  if (!CodeFile || !CodeFile.seek(pos))
+    return -1;
+  return CodeFile.read(v, n);
+}
+
+// load the code tables from the compiled image fn
+// returns 1 if the image matches CODE.CSV (size and CRC) and was loaded
+int ReadCodeBin(char *fn, uint32_t srcsize, uint32_t srccrc) {
+  CodeBinHdr h;
+  char *ptr[BINSECTS];
+  int len[BINSECTS];
+  int i, n, rc = 0;
+
+  File binFile = SD.open(fn);
+  if (!binFile)
+    return 0;
+
+  if (binFile.read(&h, sizeof(h)) == sizeof(h) && h.magic == BINMAGIC &&
+      h.version == BINVERSION && h.srcsize == srcsize && h.srccrc == srccrc &&
+      (h.flags & BINSD) == SCODESD && h.scnt >= 0 &&
+      scode.reserve(h.scnt, h.sbytes, SCODESD) >= 0) {
+    n = codebin_map(h, mcode, scode, gest, ptr, len);
+    for (rc = 1, i = 0; i < n && rc; i++)
+      rc = (binFile.read(ptr[i], len[i]) == len[i]);
+
+    if (rc) {
+      mcode.cnt = h.mcnt;
+      scode.cnt = h.scnt;
+      scode.aused = h.sbytes;
+      scode.index();  // entries are already sorted
+      pcode.pvc = h.pvc;
+    }
+    else { // truncated image - start over from CODE.CSV
+      mcode = mcodes();
+      scode.clear();
+      gest.clear();
+    }
+  }
+  binFile.close();
+  return rc;
+}
+// save the code tables as a compiled image, see CodeBinHdr
+void WriteCodeBin(char *fn, uint32_t srcsize, uint32_t srccrc) {
+  CodeBinHdr h;
+  char *ptr[BINSECTS];
+  int len[BINSECTS];
+  int i, n;
+
+  h.magic = BINMAGIC;
+  h.version = BINVERSION;
+  h.srcsize = srcsize;
+  h.srccrc = srccrc;
+  h.mcnt = mcode.cnt;
+  h.scnt = scode.cnt;
+  h.pvc = pcode.pvc;
+  h.sbytes = scode.aused;
+  h.flags = scode.sd ? BINSD : 0;
+  h.reserved = 0;
+
+  SD.remove(fn);
+  File binFile = SD.open(fn, FILE_WRITE);
+  if (!binFile) {
+    Serial.println(F("cannot write " CODEBIN));
+    return;
+  }
+  binFile.write((uint8_t *)&h, sizeof(h));
+  n = codebin_map(h, mcode, scode, gest, ptr, len);
+  for (i = 0; i < n; i++)
+    binFile.write((uint8_t *)ptr[i], len[i]);
+  binFile.close();
 }
 
 // read the User Parm File for changes in MC input timing
@@ -543,55 +861,293 @@ void ReadParmFile(char *fn) {
 
 // show labels below char buffer
 void show_labels(int Lab3, int Lab4) {
-  int r, c;
-
-  // clear label line
-  setcursor(1, -1, 2, 7, &c, &r);
-  tft.fillRect(c, r, 320, 25, ILI9341_WHITE);
-  tft.setTextSize(2);
+  const char *lab = "";
+  char a = 0;
 
   switch (Lab3) {
     case 0:
       if (inp_ch == -1)
-        tft.setTextColor(0xEEEE);
-      tft.println("<Enter>");
+        a = GA_DIM;
+      lab = "<Enter>";
       break;
     case 1:
-      tft.println("<Space>");
+      lab = "<Space>";
       break;
     case 2:
-      tft.println("<Say It>");
+      lab = "<Say It>";
       break;
   }
-  setcursor(1, -1, 10, 7, &c, &r);
-  tft.setTextColor(ILI9341_BLACK);
+  grid.text(G_LAB3, 0, lab, a);
 
+  lab = "";
+  a = 0;
   switch (Lab4) {
     case 0:
       if (char_s.size() < 1)
-        tft.setTextColor(0xEEEE);
-      tft.println("<Delete>");
+        a = GA_DIM;
+      lab = "<Delete>";
       break;
     case 1:
-      tft.println("<Backspace>");
+      lab = "<Backspace>";
       break;
     case 2:
-      tft.println("<Clear>");
+      lab = "<Clear>";
       break;
   }
+  grid.text(G_LAB4, 0, lab, a);
+  show_matches();
+}
+
+// draw the cells of the text grid that changed, see textgrid, for about
+// budget us. The rest wait for the next pass of loop, so a burst of text
+// after Enter never keeps the buttons waiting for more than budget and one
+// glyph. A budget of 0 draws them all; only setup does that, for the first
+// screen. The lines under the scan grid wait until scanning is turned off.
+// A new worst pass is reported on Serial
+void ShowGrid(unsigned long budget) {
+  int l, c, k, x;
+  char ch, buf[50];
+  unsigned long t0, t;
+
+  if (grid.pend == 0)
+    return;
+  if (grid.pend > GridDeep)
+    GridDeep = grid.pend;
+  t0 = micros();
+  while (grid.next(ScanMode ? G_DITS : GLINES, &l, &c, &k)) {
+    x = grid.x[l] + c * grid.pitch[l];
+    ch = grid.ch[grid.base[l] + c];
+    if (ch == ' ')
+      tft.fillRect(x, grid.y[l], k * grid.pitch[l], 8 * grid.size[l], ILI9341_WHITE);
+    else
+      tft.drawChar(x, grid.y[l], ch, grid.at[grid.base[l] + c] & GA_DIM ? 0xEEEE : ILI9341_BLACK,
+                   ILI9341_WHITE, grid.size[l]);
+    if (budget && micros() - t0 >= budget)
+      break;
+  }
+  t = micros() - t0;
+  if (budget && t > GridMax) {
+    GridMax = t;
+    sprintf(buf, "grid: %lu us, %d cells queued at most", GridMax, GridDeep);
+    Serial.println(buf);
+  }
+}
+
+// bar under the labels that grows while a button is held, half way across
+// at LongPress, where it turns from blue to green. Only the new slice is
+// drawn each time, at most every HOLDMS, so a held button costs a few
+// hundred pixels a second. The buttons are sampled by the interrupt, so
+// drawing never delays a press or release
+void show_hold() {
+  static unsigned long tlast;
+  static int w;  // width drawn
+  static uint16_t col;
+  unsigned long held, now = millis();
+  int nw, r, c;
+  uint16_t ncol;
+
+  if (now - tlast < HOLDMS)
+    return;
+  tlast = now;
+  held = gest.held(micros()) / 1000;
+  nw = held * 160 / LongPress;
+  if (nw > 320)
+    nw = 320;
+  ncol = held > (unsigned long) LongPress ? ILI9341_GREEN : ILI9341_BLUE;
+
+  setcursor(0, -1, 0, 7, &c, &r);
+  r += HOLDROW;
+  if (nw < w) {  // released, or a new press
+    tft.fillRect(nw, r, w - nw, HOLDH, ILI9341_WHITE);
+    w = nw;
+  }
+  if (ncol != col && w)  // crossed LongPress, or a new press
+    tft.fillRect(0, r, w, HOLDH, ncol);
+  if (nw > w)
+    tft.fillRect(w, r, nw - w, HOLDH, ncol);
+  w = nw;
+  col = ncol;
+}
+
+// in scanning mode every press goes to the scanner. Returns the action of
+// the cell selected, if any
+int ScanInput() {
+  BtnEdge e;
+  int act = A_NONE, c;
+
+  while (keys.out.get(e))  // the paddles do nothing while scanning
+    ;
+  if (ScanPend >= 0) {  // the word before the short code has been entered
+    c = ScanPend;
+    ScanPend = -1;
+    return ScanCode(c);
+  }
+  while (act == A_NONE && edges.get(e)) {
+    if (!e.down)
+      continue;
+    c = scan.press(millis());
+    if (c >= 0)
+      act = ScanSelect(c);
+    ScanDraw(0);
+  }
+  if (act == A_NONE && scan.step(millis()))
+    ScanDraw(0);
+  return act;
+}
+
+// action of the scan cell c
+int ScanSelect(int c) {
+  int r = scan.rank[c];
+  char ch;
+
+  if (ScanPage) {
+    ScanPage = 0;
+    if (r == SCCELLS - 1) {  // leave scanning
+      ScanOn(0);
+      return A_NONE;
+    }
+    ScanDraw(1);
+    if (r == SCCELLS - 2)  // back to the letters
+      return A_NONE;
+    if (word_s.ptr > 0) {  // enter the word first
+      ScanPend = r;
+      return A_SPACE;
+    }
+    return ScanCode(r);
+  }
+
+  ch = pgm_read_byte(scan_items + r);
+  switch (ch) {
+    case ' ':
+      return A_SPACE;
+    case '<':
+      scan.adapt(0);  // a correction
+      return A_BKSP;
+    case '!':
+      return A_SPEAK;
+    case ':':
+      ScanPage = 1;
+      ScanDraw(1);
+      return A_NONE;
+  }
+  inp_ch = ch;
+  timesPressed3 = 0;  // a letter, not a space
+  return A_ENTER;
+}
+
+// type the short code of rank r as a ':' word and enter it
+int ScanCode(int r) {
+  char k[3];
+
+  if (!scode.nth(r, k))
+    return A_NONE;
+  outch(':');
+  outch(k[0]);
+  if (k[1])
+    outch(k[1]);
+  return A_SPACE;
+}
+
+// turn scanning on or off, the grid takes the place of the code and label rows
+void ScanOn(int on) {
+  int l;
+
+  ScanMode = on;
+  ScanPage = 0;
+  ScanPend = -1;
+  EepUpdate(11, on);
+  scan.start(millis());
+  tft.fillRect(0, SCANY, 320, SCROWS * SCANH, ILI9341_WHITE);
+  if (on)
+    ScanDraw(1);
+  else {
+    for (l = G_DITS; l < GLINES; l++)  // drawn again by ShowGrid
+      grid.redraw(l);
+  }
+}
+
+// label of scan cell c, "" if it is empty
+int ScanLabel(int c, char *lab) {
+  int r = scan.rank[c];
+
+  lab[0] = lab[1] = lab[2] = 0;
+  if (ScanPage == 0) {
+    lab[0] = pgm_read_byte(scan_items + r);
+    if (lab[0] == ' ')
+      lab[0] = '_';
+  }
+  else if (r == SCCELLS - 1)
+    strcpy(lab, "X");
+  else if (r == SCCELLS - 2)
+    strcpy(lab, "<<");
+  else
+    scode.nth(r, lab);
+  return lab[0];
+}
+
+// draw the scan grid. Unless full, only the cells whose highlight changed
+// since the last call are drawn, so a fast scan is a few small fillRects
+void ScanDraw(int full) {
+  static int a0 = -1, a1 = -1;  // cells highlighted when last drawn
+  int b0 = scan.first(), b1 = scan.last();
+  int c, x, y, hl;
+  char lab[3];
+
+  if (!ScanMode)
+    return;
+  tft.setTextSize(2);
+  for (c = 0; c < SCCELLS; c++) {
+    hl = c >= b0 && c <= b1;
+    if (!full && hl == (c >= a0 && c <= a1))
+      continue;
+    x = c % SCCOLS * SCANW;
+    y = SCANY + c / SCCOLS * SCANH;
+    tft.fillRect(x, y, SCANW, SCANH, hl ? ILI9341_YELLOW : ILI9341_WHITE);
+    tft.setTextColor(ILI9341_BLACK, hl ? ILI9341_YELLOW : ILI9341_WHITE);  // one window a letter
+    if (ScanLabel(c, lab)) {
+      tft.setCursor(x + 4, y + 2);
+      tft.print(lab);
+    }
+  }
+  tft.setTextSize(pr_fn);
   tft.setTextColor(ILI9341_BLACK);
-  tft.setTextSize(pr_fn);  // restore font size
+  a0 = b0;
+  a1 = b1;
+}
+
+// while a ':' word is typed, show in small print under the labels how many
+// short codes start with it and the first one
+void show_matches() {
+  char k[4], fk[3], v[MAXSCODE_TXT], buf[60];
+  int i, n;
+
+  if (word_s.words[0] != ':' || word_s.ptr > 3) {
+    grid.text(G_MATCH, 0, "", 0);
+    return;
+  }
+  for (i = 0; i < 3; i++)  // keys are upper case
+    k[i] = toupper(word_s.words[i + 1]);
+  k[3] = 0;
+
+  n = scode.prefix(k, fk, v);
+  if (n)
+    snprintf(buf, GMATCH + 1, "%d: :%s %s", n, fk, v);  // one row of small print
+  else
+    strcpy(buf, "no short code");
+  grid.text(G_MATCH, 0, buf, 0);
 }
 
 // show what's in the char buffer on the bottom line
+// the decoder cursor in char_s is already advanced, so the exact match and
+// the possible next letters are read off the code tree without a search
 int show_cbuf() {
-  long cval;
-  char buf[MAXDD + 1], buf1[25], buf2[25], inp_ch, ch1[2];
-  int n, i, k, rc, r, c;
+  char buf[MAXDD + 1], buf1[25], inp_ch, ch1[2];
+  char cand[MAXCAND + 1];
+  int n, i, k, rc;
   int ch[MAXDD + 1];
 
-  cval = char_s.get_charval(n, ch);
-  k = mcode.getcode(cval, &inp_ch);
+  char_s.get_charval(n, ch);
+  k = char_s.dec.match(mcode, &inp_ch);
 
   memset(buf, 0, MAXDD + 1);
   for (i = 0; i < n; i++) {
@@ -605,16 +1161,16 @@ int show_cbuf() {
 
     strcat(buf, ch1);
   }
-  setcursor(1, -1, 3, 6, &c, &r);
-  tft.println(buf);
-  if (k > -1) {
+  grid.text(G_DITS, 0, buf, 0);
 
-    // clear the right side
-    clr_buf(2);
+  // possible next letters, in small print under the dits and dahs
+  memset(cand, 0, MAXCAND + 1);
+  char_s.dec.reach(mcode, cand, MAXCAND);
+  grid.text(G_CAND, 0, cand, 0);
 
-    // write the new char
-    tft.setTextColor(ILI9341_BLACK);
+  if (k > -1) {
 
+    // write the new char over the old one
     // handles the special cases of space, backspace, speak, and CLS
     switch (inp_ch) {
       case 'p':
@@ -632,8 +1188,7 @@ int show_cbuf() {
       default:
         sprintf(buf1, "%c", inp_ch);
     }
-    setcursor(1, -1, 11, 6, &c, &r);
-    tft.println(buf1);
+    grid.text(G_CHAR, 0, buf1, 0);
     rc = inp_ch;
   }
   else { // char not found - clear space
@@ -648,51 +1203,45 @@ int show_cbuf() {
 // mode 1 - clear only char buff, no "OK"
 // mode 2 - clear the Word line
 // mode 3 - clear the message area (lines 1-4) 
+// Only the text grid is cleared, ShowGrid then erases the cells that had
+// something in them
 void cls(int mode) {
-  int row = WORDROW * SIZER;
-  int cols = NCOL * SIZEC;
-  int msgRows = SIZER * 5;  
+  int l;
 
   if (mode == 0) {
     message_s.clear(); 
+    SpeakClose();
+    SpeakPos = -1;
     word_s.clear();
     char_s.clear();
-    tft.fillScreen(0xFFFF);
-    tft.setCursor(0, (WORDROW * SIZER));
-    tft.print("OK>");
-    CursorMgt(1, 1); // turn on cursor
+    for (l = 0; l < GLINES; l++)
+      grid.text(l, 0, "", 0);
+    show_word();
   }
-  else if (mode == 1)
+  else if (mode == 1) {
     tft.fillScreen(0xFFFF);
+    for (l = 0; l < GLINES; l++)  // drawn again by ShowGrid
+      grid.redraw(l);
+  }
   else if (mode == 2) { // clear the Word line 
     word_s.clear();
     char_s.clear();
-    tft.fillRect(0, row, cols, SIZER, ILI9341_WHITE);
-    tft.setCursor(0, (WORDROW * SIZER));
-    tft.print("OK>");
-    CursorMgt(1, 1); // turn on cursor
+    show_word();
   }
   else if (mode == 3) {  // clear the Message Area
-    tft.fillRect(0, 0, cols, msgRows, ILI9341_WHITE);
+    for (l = G_MSG; l < G_MSG + 5; l++)
+      grid.text(l, 0, "", 0);
   } 
 }
 
 // clear buffer area - side=1 left, side=2 right, both=3
 void clr_buf(int side) {
-  int r, c;
-
-  if (side == 1) { // left
-    setcursor(1, -1, 0, 6, &c, &r);
-    tft.fillRect(c, r, 199, 25, ILI9341_WHITE);
-  }
-  else if (side == 2) { // right
-    setcursor(1, -1, 11, 6, &c, &r);
-    tft.fillRect(c, r, 100, 50, ILI9341_WHITE);
-  }
-  else {
-    setcursor(1, -1, 0, 6, &c, &r);
-    tft.fillRect(c, r, 320, 25, ILI9341_WHITE);
+  if (side != 2) { // left
+    grid.text(G_DITS, 0, "", 0);
+    grid.text(G_CAND, 0, "", 0);
   }
+  if (side != 1) // right
+    grid.text(G_CHAR, 0, "", 0);
 }
 // backspace on the tft -
 // -1 flags to erase last character and pop the stack
@@ -703,7 +1252,6 @@ void backspace() {
 // Display Message in upper part of screen
 int DisplayMessage() {
     static int Row, Col;
-    int tftcol, tftrow; 
     int ptr, len, newcol;
     char word[MAXWORD]; 
     char buf[50];
@@ -722,109 +1270,119 @@ int DisplayMessage() {
         if (newcol >= NCOL) {
             Col = 0; 
             Row++;
-            if (Row > 4) {
-                tftcol = (NCOL-3) * SIZEC;
-                tftrow = 4 * SIZER;
-                tft.setCursor(tftcol, tftrow);
-                tft.println("..");
-                delay(3000); 
-                cls(3);
-                Col = 0; 
-                Row = 0; 
+            if (Row > 4) {  // scroll the message area up MSGJUMP rows
+                grid.scroll(G_MSG, G_MSG + 4, MSGJUMP);
+                Row = 5 - MSGJUMP;
             }
         }
     }
     
-    tftcol = Col * SIZEC;
-    tftrow = Row * SIZER;
-    tft.setCursor(tftcol, tftrow);
-    tft.println(word);
+    grid.text(G_MSG + Row, Col, word, 0);
 
     // ready for the next word
     Col += len + 1; 
 }
 
-// return the entire message in msg
-int GetMessage(char *msg) {
-    int i, j, len; 
-    char buf[MAXWORD]; 
-
-    i = message_s.get_ptr();
+// speak the message. The text is sent straight from message_s in chunks
+// of up to EMICBUF chars that end at a word, each once the EMIC 2 has
+// answered ':' for the command before (see SpeakNext). Speaking again
+// starts over: a chunk still being sent is cut short, and the message
+// follows once the EMIC 2 has finished it
+void SayMessage() {
+    SpeakClose();
+    SpeakPos = message_s.drop;
+}
 
-    for (j=0; j < i; j++) {
-        message_s.get_msg(j, buf);
-        len = strlen(msg) + strlen(buf) + 1; 
-        if (len < MAXWORD_TXT) {
-            strcat(msg, buf); 
-            if (j)
-                strcat(msg, " "); 
-        }
+// called from loop: send what fits in the Serial1 buffer without waiting,
+// at 9600 baud a whole chunk would hold up the buttons for up to a second.
+// Once the chunk is sent, start the next when the EMIC 2 is ready for it.
+// Words dropped or taken off message_s since are skipped
+void SpeakNext() {
+    long first, last;
+    int room;
+
+    while (Serial1.available())
+        if (Serial1.read() == ':' && SpeakWait > 0)
+            SpeakWait--;
+    if (SpeakWait > 0 && millis() - SpeakSent > EMICWAIT)  // a lost ':'
+        SpeakWait = 0;
+
+    if (SpeakPos < 0)
+        return;
+    first = message_s.drop;
+    last = first + message_s.used;
+    if (SpeakPos < first)
+        SpeakPos = first;
+    if (SpeakPos > last)
+        SpeakPos = last;
+    if (SpeakEnd > last)
+        SpeakEnd = last;
+    if (SpeakEnd < 0) {
+        if (SpeakWait == 0)
+            SpeakChunk();
+        return;
     }
-    i = strlen(msg); 
-    return i; 
+    room = Serial1.availableForWrite();
+    for (; room > 0 && SpeakPos < SpeakEnd; room--)
+        Serial1.write(message_s.at(SpeakPos++ - first));
+    if (SpeakPos >= SpeakEnd && room > 0)
+        SpeakClose();
 }
 
+// start the say command for the chunk at SpeakPos, SpeakNext sends it
+void SpeakChunk() {
+    int n;
 
-// output to tft 
-int outch(char chr) {
-  int i, i1, j, nr, lenw, lenbuf, ptr, row, ptr1;
-  static int cursor_c, cursor_r;
-  char ch, c1[3], buf[20];
+    n = message_s.chunk(SpeakPos - message_s.drop, EMICBUF);
+    if (n == 0) {  // all sent
+        SpeakPos = -1;
+        return;
+    }
+    Serial1.write('S');
+    SpeakEnd = SpeakPos + n;
+}
 
-  // fixed row for word display
-  row = SIZER * WORDROW; 
+// end the say command being sent, if any, where it is
+void SpeakClose() {
+    if (SpeakEnd < 0)
+        return;
+    Serial1.write('\n');
+    SpeakEnd = -1;
+    SpeakWait++;
+    SpeakSent = millis();
+}
 
-  // setup pointer to cursor position
-  ptr = word_s.get_ptr();
+// send a whole command line to the EMIC 2, eg "N3\n"
+void EmicSend(const char *cmd) {
+    Serial1.print(cmd);
+    SpeakWait++;
+    SpeakSent = millis();
+}
 
-  // if char input, push to word stack
-  if (chr > 0) {
-    ptr = word_s.push(chr);
-  }
-  // if char input and tft enabled
-  if (chr > 0) {
-    if (ptr < MAXWORD_TXT - 1) {
-      CursorMgt(0, 0);  // turn off previously set cursor
-      tft.setTextColor(ILI9341_BLACK);
-      setcursor_wrd(1, ptr, 0, 0, &cursor_c);
-      tft.print(chr);
-      CursorMgt(1, ptr + 1); // turn on new cursor
-    }
-  }
-  else if (chr < 1) { // backspace
-    CursorMgt(0, 0);  // turn off previously set cursor
-    i = word_s.pop();
-    ptr = word_s.get_ptr();
-    ptr1 = ptr + 4;
-    setcursor(1, ptr1, 0, 0, &cursor_c, &cursor_r);
-    tft.fillRect(cursor_c, row, 50, 25, ILI9341_WHITE);
-    CursorMgt(1, ptr + 1); // turn on cursor
-  }
-  return cursor_r;
+// output to tft 
+// chr > 0 is added to the word, -1 erases the last character and pops the
+// stack; returns the length of the word
+int outch(char chr) {
+  if (chr > 0)
+    word_s.push(chr);
+  else
+    word_s.pop();
+  show_word();
+  return word_s.get_ptr();
 }
 
-// create and destroy cursor
-// c_on: 1 turns on cursor
-// c_on: 0 turns off previously set cursor
-// pos: position of cursor
-void CursorMgt(int c_on, int pos) {
-  int c, r;
-  static int tftcol, tftrow;
-
-  //tftrow = 150;
-  //tftcol = 0; 
-  //pos += 4;  
-
-  if (c_on) {
-    tft.setTextColor(ILI9341_BLACK);
-    setcursor_wrd(1, pos, 0, 0, &tftcol);
-    tft.print("_");
-  }
-  else {
-    tft.setTextColor(ILI9341_WHITE);
-    setcursor_wrd(1, -1, -1, -1, &tftcol);
-    tft.print("_");
-  }
+// the word row: "OK>", the word and the cursor after it
+void show_word() {
+  char buf[NCOL + 1];
+  int n = word_s.get_ptr();
+
+  if (n > NCOL - 4)
+    n = NCOL - 4;
+  memcpy(buf, "OK>", 3);
+  memcpy(buf + 3, word_s.words, n);
+  buf[n + 3] = '_';
+  buf[n + 4] = 0;
+  grid.text(G_WORD, 0, buf, 0);
 }
 
 // set the tft cursor in the position needed
@@ -857,35 +1415,6 @@ void setcursor(short mode, int pos, int col, int row, int *tftcol, int *tftrow)
     tft.setCursor(*tftcol, *tftrow);
 }
 
-// set the tft cursor in the position needed
-// if pos is provided, placement is relative to 0, 0 with wrapping as each line is filled
-// if row/col provided, placement is absolute
-// -1 in pos indicates that row/col placement to be used
-// -1 in row indicates that tftcol and tftrow be used for placement
-// mode - 0 do nothing but return values in tftcol and tftrow. non-zero move cursor and return values
-void setcursor_wrd(short mode, int pos, int col, int row, int *tftcol) {
-  short pos1, r, c;
-  int tftrow = WORDROW * SIZER;
-  char buf5[50];
-
-  if (pos != -1) {  // based on pointer - lines can overflow
-    pos1 = pos - 1; // subtract one to make zero based
-    pos1 += 3;  // add 3 to begin after prompt "OK>"
-    if (pos1 < NCOL) {
-      *tftcol = pos1 * SIZEC;
-    }
-    else {
-      r = (short) pos1 / NCOL;
-      *tftcol = SIZEC * (pos1 - (r * NCOL));
-    }
-  }
-  else if (row != -1) {
-    *tftcol = SIZEC * col;
-  }
-  if (mode)
-    tft.setCursor(*tftcol, tftrow);
-}
-
 // similar to php function
 // used to find = sign in parmameter input from user
 int strpos(char *hay, int need, int offset) {
@@ -942,6 +1471,120 @@ int VoiceLookup(char *VOZCode)
   }
   return -1;
 }
+// Auto commit codes, the message to show goes in buf
+// :A1 - :A9 - enter the letter after 0.2 to 1.8 seconds with no dit or dah
+// :A0 - auto commit off
+// :W1 - :W9 - enter a space 0.5 to 4.5 seconds after the last letter
+int AutoLookup(char *ACode, char *buf)
+{
+  char buf1[10];
+  int n = ACode[1] - '0';
+
+  if ((ACode[0] != 'A' && ACode[0] != 'W') || n < 0 || n > 9)
+    return -1;
+  if (ACode[0] == 'A') {
+    AutoLetter = n * 200;
+    EepUpdate(8, AutoLetter);
+  }
+  else if (n > 0) {
+    AutoWord = n * 500;
+    EepUpdate(9, AutoWord);
+  }
+  else
+    return -1;
+  if (AutoWord == 0) {  // first use
+    AutoWord = 1500;
+    EepUpdate(9, AutoWord);
+  }
+
+  if (!AutoLetter) {
+    sprintf(buf, "Auto Commit off");
+    wheel.cancel(T_LETTER);
+    wheel.cancel(T_WORD);
+  }
+  else {
+    dtostrf((float) AutoLetter / 1000.0, 3, 1, buf1);
+    sprintf(buf, "Auto Letter %s Sec. ", buf1);
+    dtostrf((float) AutoWord / 1000.0, 3, 1, buf1);
+    sprintf(buf + strlen(buf), "Word %s Sec.", buf1);
+  }
+  return 0;
+}
+
+// Keyer codes, the message to show goes in buf
+// :KA - iambic mode A, :KB - iambic mode B, :KS - straight keys (keyer off)
+// :K1 - :K9 - keyer speed, 5 to 45 words per minute
+int KeyerLookup(char *KCode, char *buf)
+{
+  int m = keys.mode, wpm = 1200 / keys.unit;
+
+  if (KCode[0] != 'K')
+    return -1;
+  if (KCode[1] == 'A')
+    m = K_IAMBIC_A;
+  else if (KCode[1] == 'B')
+    m = K_IAMBIC_B;
+  else if (KCode[1] == 'S')
+    m = K_OFF;
+  else if (KCode[1] >= '1' && KCode[1] <= '9')
+    wpm = (KCode[1] - '0') * 5;
+  else
+    return -1;
+
+  wpm = keys.set(m, wpm);
+  EepUpdate(6, m);
+  EepUpdate(7, wpm);
+  if (m == K_OFF)
+    sprintf(buf, "Keyer off");
+  else
+    sprintf(buf, "Keyer %c %d WPM", m == K_IAMBIC_A ? 'A' : 'B', wpm);
+  return 0;
+}
+
+// Long Press tuning codes, the message to show goes in buf
+// :LS - show the Long Press learned from the presses so far
+// :LY - use the learned Long Press from now on, :LN - stop using it
+int LongPressTune(char *LPCode, char *buf)
+{
+  char buf1[10];
+  int lp;
+
+  if (strcmp(LPCode, "LY") == 0 || strcmp(LPCode, "LN") == 0) {
+    EepUpdate(4, LPCode[1] == 'Y');
+    sprintf(buf, "Auto Long Press %s", LPCode[1] == 'Y' ? "on" : "off");
+    LearnLongPress();
+  }
+  else if (strcmp(LPCode, "LS") == 0) {
+    if ((lp = tuner.suggest(LongPress)) < 0)
+      lp = Eep.v[0];
+    if (lp <= 0)
+      sprintf(buf, "Long Press not learned yet");
+    else {
+      dtostrf((float) lp / 1000.0, 3, 1, buf1);
+      sprintf(buf, "Learned Long Press %s Sec. %d misfires", buf1, tuner.misfire);
+    }
+  }
+  else
+    return -1;
+  return 0;
+}
+
+// save the learned Long Press and misfires when they change, and use the
+// learned Long Press if that is turned on. Called at the end of a word so
+// the threshold never moves during a letter
+void LearnLongPress() {
+  int lp = tuner.suggest(LongPress);
+
+  if (lp > 0 && abs(lp - Eep.v[0]) > LPBIN)  // not for each small wobble
+    EepUpdate(3, lp);
+  if (tuner.misfire != Eep.v[2])
+    EepUpdate(5, tuner.misfire);
+  if (Eep.v[1] && Eep.v[0] > 0 && abs(Eep.v[0] - LongPress) > LongPress / 10) {
+    LongPress = Eep.v[0];
+    EepUpdate(1, LongPress);
+  }
+}
+
 // SD Card fgets
 //
 char *SD_fgets(char *str, int sz, File fp)
@@ -960,6 +1603,15 @@ char *SD_fgets(char *str, int sz, File fp)
 // Update the EEPROM data
 // mode 1 - update LongPress
 // mode 2 - update Voice
+// mode 3 - update learned Long Press
+// mode 4 - update use of the learned Long Press
+// mode 5 - update Long Press misfires
+// mode 6 - update keyer mode
+// mode 7 - update keyer words per minute
+// mode 8 - update letter auto commit
+// mode 9 - update word auto commit
+// mode 10 - update scan ms per step
+// mode 11 - update scanning on
 int EepUpdate(int mode, int val) {
     // read EEPROM data
     EEPROM.get(Adr, Eep);
@@ -971,6 +1623,17 @@ int EepUpdate(int mode, int val) {
         case 2:
            Eep.Voice = val; 
            break; 
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+        case 9:
+        case 10:
+        case 11:
+           Eep.v[mode - 3] = val; 
+           break; 
         default:
            break; 
     }
@@ -984,10 +1647,11 @@ void bmpDraw(char *filename, uint8_t x, uint16_t y) {
   uint32_t bmpImageoffset;        // Start of image data in file
   uint32_t rowSize;               // Not always = bmpWidth; may have padding
   uint8_t  sdbuffer[3 * BUFFPIXEL]; // pixel buffer (R+G+B per pixel)
+  uint16_t tftbuffer[BUFFPIXEL];  // the same pixels in TFT format
   uint8_t  buffidx = sizeof(sdbuffer); // Current position in sdbuffer
   boolean  goodBmp = false;       // Set to true on valid header parse
   boolean  flip    = true;        // BMP is stored bottom-to-top
-  int      w, h, row, col;
+  int      w, h, row, col, n;
   uint8_t  r, g, b;
   uint32_t pos = 0, startTime = millis();
 
@@ -1061,19 +1725,23 @@ void bmpDraw(char *filename, uint8_t x, uint16_t y) {
             buffidx = sizeof(sdbuffer); // Force buffer reload
           }
 
-          for (col = 0; col < w; col++) { // For each pixel...
+          for (col = 0; col < w; col += n) { // For each block of pixels...
             // Time to read more pixel data?
             if (buffidx >= sizeof(sdbuffer)) { // Indeed
               bmpFile.read(sdbuffer, sizeof(sdbuffer));
               buffidx = 0; // Set index to beginning
             }
 
-            // Convert pixel from BMP to TFT format, push to display
-            b = sdbuffer[buffidx++];
-            g = sdbuffer[buffidx++];
-            r = sdbuffer[buffidx++];
-            tft.pushColor(tft.color565(r, g, b));
-          } // end pixel
+            // Convert the buffered pixels from BMP to TFT format and
+            // push them to the display in one block
+            for (n = 0; col + n < w && buffidx < sizeof(sdbuffer); n++) {
+              b = sdbuffer[buffidx++];
+              g = sdbuffer[buffidx++];
+              r = sdbuffer[buffidx++];
+              tftbuffer[n] = tft.color565(r, g, b);
+            }
+            tft.writePixels(tftbuffer, n);
+          } // end pixels
         } // end scanline
         Serial.print(F("Loaded in "));
         Serial.print(millis() - startTime);
@@ -0,0 +1,52 @@
+/* m2g_codes.h -- built-in code tables, kept in flash
+ * generated from CODE.CSV by tools/m2gc.cpp -- do not edit
+ *   m2gc -h CODE.CSV m2g_codes.h
+ */
+
+#ifndef M2G_CODES_H
+#define M2G_CODES_H
+
+#define DEF_MCNT 53
+#define DEF_SCNT 2
+#define DEF_SHASHBITS 2
+
+const char def_mtab[MTABSZ] PROGMEM = {
+  0, 0, 'E', 'T', 'I', 'A', 'N', 'M',
+  'S', 'U', 'R', 'W', 'D', 'K', 'G', 'O',
+  'H', 'V', 'F', 'p', 'L', 0, 'P', 'J',
+  'B', 'X', 'C', 'Y', 'Z', 'Q', 0, 'b',
+  '5', '4', 0, '3', 'c', 0, 0, '2',
+  0, 0, '+', 0, 0, 0, 's', '1',
+  '6', '=', '/', 0, 0, 0, '(', 0,
+  '7', 0, 0, 0, '8', 0, '9', '0',
+  0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, '?', 0, 0, 0,
+  0, 0, '"', 0, 0, '.', 0, 0,
+  0, 0, '@', 0, 0, 0, '\'', 0,
+  0, '-', 0, 0, 0, 0, 0, 0,
+  0, 0, 0, '!', 0, ')', 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,
+  ':', 0, 0, 0, 0, 0, 0, 0,
+};
+
+const unsigned char def_mlive[MTABSZ / 8] PROGMEM = {
+  0xfe, 0xff, 0xff, 0xff, 0xdb, 0xe6, 0x67, 0xd1, 0x00, 0x10, 0x24, 0x44, 0x02, 0x28, 0x00, 0x01,
+};
+
+const char def_skey[DEF_SCNT + 1][3] PROGMEM = {
+  "IH", "IT", ""
+};
+
+const uint16_t def_soff[DEF_SCNT + 1] PROGMEM = {
+  0, 12, 25
+};
+
+const char def_sval[] PROGMEM =
+  "I am hungry" "\0"
+  "I am thirsty" "\0";
+
+const uint16_t def_shash[1 << DEF_SHASHBITS] PROGMEM = {
+  1, 0, 2, 0,
+};
+
+#endif
@@ -0,0 +1,105 @@
+/* debtest.cpp -- host checks of the button debouncer, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative
+Commons Attribution-ShareAlike 4.0 International License. For more information
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/
+-- Basically, you can use this software for any purpose for free,
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line.
+
+Samples made up switch waveforms every DEBTICKS ms, as the timer interrupt
+does, through the sketch's own debouncer from m2g.cpp. Each of NBTN switches
+gets presses of 40 to 640 ms whose edges bounce for a while, and a 1 ms
+glitch between presses. Every press and release must come out once, in
+order, within 4 samples of the end of its bounce.
+
+  build:  g++ -o debtest tools/debtest.cpp      (from the m2g_22 directory)
+  usage:  debtest
+
+Prints the edges and their latency for each length of bounce, and exits
+with 1 if any edge was lost, doubled or late.
+*/
+
+#include "../m2g.cpp"
+
+#include <stdlib.h>
+
+#define WAVEMS 200000L  // ms of waveform per bounce length
+#define MAXEDGES 2000  // edges per switch
+
+static swbits wave[WAVEMS];  // 1 - open, one sample per ms
+static long edge[NBTN][MAXEDGES];  // ms of each real edge
+static int nedge[NBTN];
+
+// presses with bounce ms of random chatter after each edge
+static void makewave(int bounce) {
+  long t, i, hold, gap, e;
+  int b, k;
+
+  memset(wave, 0xff, sizeof(wave));
+  for (b = 0; b < NBTN; b++) {
+    nedge[b] = 0;
+    for (t = 100; t < WAVEMS - 2000 && nedge[b] < MAXEDGES - 1; t += hold + gap) {
+      hold = 40 + rand() % 600;
+      gap = 60 + rand() % 600;
+      edge[b][nedge[b]++] = t;
+      edge[b][nedge[b]++] = t + hold;
+      for (i = t; i < t + hold; i++)
+        wave[i] &= ~(1 << b);
+      for (k = 0; k < 2; k++)
+        for (e = edge[b][nedge[b] - 2 + k], i = 0; i < bounce; i++)
+          if (rand() % 2)
+            wave[e + i] ^= 1 << b;
+      wave[t + hold + bounce + gap / 2] ^= 1 << b;  // a glitch
+    }
+  }
+}
+
+int main() {
+  static const int bounces[] = {0, 3, 5, 8, 12};
+  static long seen[NBTN][MAXEDGES];
+  int nseen[NBTN];
+  debouncer d;
+  long t, lat, maxlat, sumlat, window;
+  int i, b, k, edges, bad, fails = 0;
+  swbits f;
+
+  srand(1);
+  for (i = 0; i < (int)(sizeof(bounces) / sizeof(bounces[0])); i++) {
+    makewave(bounces[i]);
+    d = debouncer();
+    memset(nseen, 0, sizeof(nseen));
+    for (t = 0; t < WAVEMS; t += DEBTICKS) {
+      f = d.update(wave[t]);
+      for (b = 0; b < NBTN; b++)
+        if ((f & (1 << b)) && nseen[b] < MAXEDGES)
+          seen[b][nseen[b]++] = t;
+    }
+
+    // the state flips on the 4th sample in a row that differs from it
+    window = bounces[i] + 4 * DEBTICKS + DEBTICKS;
+    edges = bad = 0;
+    maxlat = sumlat = 0;
+    for (b = 0; b < NBTN; b++) {
+      edges += nedge[b];
+      if (nseen[b] != nedge[b])
+        bad += abs(nseen[b] - nedge[b]);
+      for (k = 0; k < nseen[b] && k < nedge[b]; k++) {
+        lat = seen[b][k] - edge[b][k];
+        if (lat < 0 || lat > window)
+          bad++;
+        sumlat += lat;
+        if (lat > maxlat)
+          maxlat = lat;
+      }
+    }
+    printf("bounce %2d ms: %4d edges, %d wrong, latency avg %.1f max %ld ms\n",
+           bounces[i], edges, bad, (double) sumlat / edges, maxlat);
+    if (bad)
+      fails++;
+  }
+
+  printf(fails ? "%d failed\n" : "all passed\n", fails);
+  return fails != 0;
+}
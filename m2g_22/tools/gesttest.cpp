@@ -0,0 +1,82 @@
+/* gesttest.cpp -- host checks of the button gestures, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative
+Commons Attribution-ShareAlike 4.0 International License. For more information
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/
+-- Basically, you can use this software for any purpose for free,
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line.
+
+Feeds button edges to gestures, the sketch's own class from m2g.cpp, as
+loop() does, and checks the actions that come out: taps and slow presses
+of each button with the built-in table, and taps that end the double tap
+wait of another button.
+
+  build:  g++ -o gesttest tools/gesttest.cpp      (from the m2g_22 directory)
+  usage:  gesttest
+
+Prints each check and exits with 1 if any of them failed.
+*/
+
+#include "../m2g.cpp"
+
+static int fails;
+
+static void check(const char *what, int got, int want) {
+  printf("%-44s %-7s (want %s)\n", what, act_names[got], act_names[want]);
+  if (got != want)
+    fails++;
+}
+
+static int edge(gestures &g, int b, int down, unsigned long ms) {
+  BtnEdge e;
+
+  e.btn = b;
+  e.down = down;
+  e.t = ms * 1000;
+  return g.feed(e, LONGPRESS);
+}
+
+// press button b at ms for len ms, the action of the release
+static int press(gestures &g, int b, unsigned long ms, unsigned long len) {
+  edge(g, b, 1, ms);
+  return edge(g, b, 0, ms + len);
+}
+
+int main() {
+  static const unsigned char tap[NBTN] = {A_DIT, A_DAH, A_ENTER, A_DELETE};
+  static const unsigned char slow[NBTN] = {A_ENTER, A_DELETE, A_ENTER, A_DELETE};
+  char what[60];
+  int b, a;
+
+  for (b = 0; b < NBTN; b++) {
+    gestures g;
+
+    sprintf(what, "button %d tap", b + 1);
+    check(what, press(g, b, 1000, 100), tap[b]);
+    sprintf(what, "button %d held %d ms", b + 1, 2 * LONGPRESS);
+    check(what, press(g, b, 2000, 2 * LONGPRESS), slow[b]);
+  }
+
+  {
+    gestures g;
+    char l1[] = "gcode,1,double,speak", l2[] = "gcode,2,double,clear";
+
+    g.loadcode(l1);
+    g.loadcode(l2);
+    check("button 1 tap, waiting for a double", press(g, 0, 1000, 100), A_NONE);
+    check("button 2 press ends the wait", edge(g, 1, 1, 1150), A_DIT);
+    check("button 2 release, waiting", edge(g, 1, 0, 1250), A_NONE);
+    check("button 3 press ends the wait", edge(g, 2, 1, 1300), A_DAH);
+    check("button 3 release", edge(g, 2, 0, 1400), A_ENTER);
+    check("nothing left", g.poll(5000000UL), A_NONE);
+    check("button 1 held past LongPress: long, no wait", press(g, 0, 6000, 2 * LONGPRESS), A_ENTER);
+    a = press(g, 1, 8000, 100);
+    check("button 2 tap, waiting", a, A_NONE);
+    check("wait over", g.poll((8100UL + DBLTAP + 1) * 1000), A_DAH);
+  }
+
+  printf(fails ? "%d failed\n" : "all passed\n", fails);
+  return fails != 0;
+}
@@ -0,0 +1,125 @@
+/* lptest.cpp -- host checks of the Long Press tuner, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative
+Commons Attribution-ShareAlike 4.0 International License. For more information
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/
+-- Basically, you can use this software for any purpose for free,
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line.
+
+Feeds lptuner and gestures, the sketch's own classes from m2g.cpp, with
+made up presses and checks what they count and suggest.
+
+  build:  g++ -o lptest tools/lptest.cpp      (from the m2g_22 directory)
+  usage:  lptest
+
+Prints each check and exits with 1 if any of them failed.
+*/
+
+#include "../m2g.cpp"
+
+#include <stdlib.h>
+#include <math.h>
+
+static int fails;
+
+static void check(const char *what, int got, int want) {
+  printf("%-44s %5d (want %d)\n", what, got, want);
+  if (got != want)
+    fails++;
+}
+
+static void checkrange(const char *what, int got, int lo, int hi) {
+  printf("%-44s %5d (want %d to %d)\n", what, got, lo, hi);
+  if (got < lo || got > hi)
+    fails++;
+}
+
+// press button b at ms for len ms, as the sketch's loop sees it:
+// the edges go to the tuner and the gestures, the action to the tuner
+static int press(lptuner &t, gestures &g, int b, unsigned long ms, unsigned long len) {
+  BtnEdge d, u;
+  int a;
+
+  d.btn = u.btn = b;
+  d.down = 1;
+  u.down = 0;
+  d.t = ms * 1000;
+  u.t = (ms + len) * 1000;
+  t.edge(g, d, LONGPRESS);
+  g.feed(d, LONGPRESS);
+  t.edge(g, u, LONGPRESS);
+  a = g.feed(u, LONGPRESS);
+  if (a != A_NONE)
+    t.action(a, ms + len);
+  return a;
+}
+
+// a delete as another button's tap
+static void del(lptuner &t, gestures &g, unsigned long ms) {
+  press(t, g, 3, ms, 100);
+}
+
+// log normal press length around mu ms (Box-Muller)
+static unsigned long presslen(double mu, double sigma) {
+  double u1 = (rand() + 1.0) / (RAND_MAX + 2.0), u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+  return (unsigned long) exp(log(mu) + sigma * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2));
+}
+
+int main() {
+  double shortmu[] = {150, 250, 200}, longmu[] = {700, 900, 500};
+  unsigned long ms;
+  int c, i;
+
+  {
+    lptuner t;
+    gestures g;
+
+    press(t, g, 0, 1000, 900);
+    del(t, g, 2500);
+    check("long Enter, then Delete: misfire", t.misfire, 1);
+    press(t, g, 0, 5000, 900);
+    del(t, g, 8000);
+    check("long Enter, Delete after LPUNDO: no misfire", t.misfire, 1);
+    press(t, g, 0, 10000, 100);
+    del(t, g, 10500);
+    check("tap, then Delete: no misfire", t.misfire, 1);
+  }
+  {
+    lptuner t;
+    gestures g;
+
+    // the long press of button 2 is Delete, so these are a run of deletes
+    for (ms = 1000, i = 0; i < 5; i++, ms += 1200)
+      press(t, g, 1, ms, 900);
+    check("long Delete, then long Delete: no misfire", t.misfire, 0);
+    del(t, g, ms);
+    check("long Delete, then tap Delete: no misfire", t.misfire, 0);
+  }
+  {
+    lptuner t;
+
+    check("no presses: no suggestion", t.suggest(LONGPRESS), -1);
+    for (i = 0; i < 60; i++)
+      t.hist[3 + i % 6]++, t.n++;
+    check("taps only: no suggestion", t.suggest(LONGPRESS), -1);
+  }
+
+  // presses of one kind of user, a fifth of them long
+  srand(3);
+  for (c = 0; c < 3; c++) {
+    lptuner t;
+    gestures g;
+    char what[60];
+
+    for (ms = 1000, i = 0; i < 400; i++, ms += 2500)
+      press(t, g, i & 1, ms, rand() % 5 ? presslen(shortmu[c], 0.35) : presslen(longmu[c], 0.25));
+    sprintf(what, "short %.0f long %.0f ms: suggestion", shortmu[c], longmu[c]);
+    checkrange(what, t.suggest(LONGPRESS), (int) shortmu[c], (int) longmu[c]);
+  }
+
+  printf(fails ? "%d failed\n" : "all passed\n", fails);
+  return fails != 0;
+}
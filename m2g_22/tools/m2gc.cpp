@@ -0,0 +1,256 @@
+/* m2gc.cpp -- CODE.CSV to CODE.BIN compiler, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative 
+Commons Attribution-ShareAlike 4.0 International License. For more information 
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/ 
+-- Basically, you can use this software for any purpose for free, 
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line. 
+
+Builds the same CODE.BIN image that the sketch writes after parsing CODE.CSV,
+so a freshly copied card boots from the image the first time. The parser is
+the sketch's own m2g.cpp.
+
+  build:  g++ -o m2gc tools/m2gc.cpp      (from the m2g_22 directory)
+  usage:  m2gc CODE.CSV [CODE.BIN]
+          m2gc -h CODE.CSV [m2g_codes.h]
+
+Copy both files to the Micro SD card. CODE.BIN is ignored by the sketch if
+CODE.CSV is later edited (its size and CRC are stored in the header).
+
+With -h, the tables are written as the m2g_codes.h header instead. It holds
+the built-in codes that the sketch keeps in flash and uses when there is no
+card, or when the card does not define a code. Rebuild the sketch after
+regenerating it.
+
+Build with -DSCODESD=1 for a sketch that leaves the short code phrases on
+the card; the image then holds their offsets in CODE.CSV instead.
+*/
+
+#include "../m2g.cpp"
+
+// same line reader as SD_fgets in the sketch
+char *csv_fgets(char *str, int sz, FILE *fp)
+{
+  int ch = EOF;
+  char *buf = str;
+
+  while (--sz > 0 && (ch = getc(fp)) != EOF) {
+    if ((*buf++ = ch) == '\n')  /* EOL */
+      break;
+  }
+  *buf = '\0';
+  return (ch == EOF && buf == str) ? NULL : str;
+}
+
+// write a C string literal, escaping quotes, backslashes and control chars
+void put_cstr(FILE *fp, const char *str) {
+  fputc('"', fp);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\')
+      fprintf(fp, "\\%c", *str);
+    else if ((unsigned char) *str < ' ')
+      fprintf(fp, "\\%03o", (unsigned char) *str);
+    else
+      fputc(*str, fp);
+  }
+  fputc('"', fp);
+}
+
+// write the tables as the m2g_codes.h header, see m2g_codes.h
+int write_header(const char *fn, const char *src, mcodes &mcode, scodes &scode) {
+  int i, h, off, bits, mask;
+  uint16_t *hash;
+  char key[3];
+  char val[MAXSCODE_TXT];
+  char c;
+
+  FILE *fp = fopen(fn, "w");
+  if (!fp) {
+    perror(fn);
+    return 1;
+  }
+
+  // hash index for getdefault, at most half full
+  for (bits = 1; (1 << bits) < 2 * scode.cnt; bits++)
+    ;
+  mask = (1 << bits) - 1;
+  hash = (uint16_t *) calloc(1 << bits, 2);
+  for (i = 0; i < scode.cnt; i++) {
+    for (h = skhash(scode.skey[i], bits); hash[h]; h = (h + 1) & mask)
+      ;
+    hash[h] = i + 1;
+  }
+
+  fprintf(fp, "/* m2g_codes.h -- built-in code tables, kept in flash\n");
+  fprintf(fp, " * generated from %s by tools/m2gc.cpp -- do not edit\n", src);
+  fprintf(fp, " *   m2gc -h %s %s\n */\n\n", src, fn);
+  fprintf(fp, "#ifndef M2G_CODES_H\n#define M2G_CODES_H\n\n");
+  fprintf(fp, "#define DEF_MCNT %d\n#define DEF_SCNT %d\n#define DEF_SHASHBITS %d\n\n",
+          mcode.cnt, scode.cnt, bits);
+
+  // morse codes, indexed by packed code like mcodes::mtab
+  fprintf(fp, "const char def_mtab[MTABSZ] PROGMEM = {");
+  for (i = 0; i < MTABSZ; i++) {
+    c = mcode.mtab[i];
+    fprintf(fp, "%s", i % 8 ? " " : "\n  ");
+    if (!c)
+      fprintf(fp, "0,");
+    else if (c == '\'' || c == '\\')
+      fprintf(fp, "'\\%c',", c);
+    else
+      fprintf(fp, "'%c',", c);
+  }
+  fprintf(fp, "\n};\n\n");
+
+  fprintf(fp, "const unsigned char def_mlive[MTABSZ / 8] PROGMEM = {\n ");
+  for (i = 0; i < MTABSZ / 8; i++)
+    fprintf(fp, " 0x%02x,", mcode.mlive[i]);
+  fprintf(fp, "\n};\n\n");
+
+  // short codes, sorted by key by scodes::sortcode; values are packed end to end
+  fprintf(fp, "const char def_skey[DEF_SCNT + 1][3] PROGMEM = {\n ");
+  for (i = 0; i < scode.cnt; i++) {
+    key[0] = scode.skey[i] >> 8;
+    key[1] = scode.skey[i] & 0xFF;
+    key[2] = 0;
+    fprintf(fp, " ");
+    put_cstr(fp, key);
+    fprintf(fp, ",");
+  }
+  fprintf(fp, " \"\"\n};\n\n");
+
+  fprintf(fp, "const uint16_t def_soff[DEF_SCNT + 1] PROGMEM = {\n ");
+  for (off = 0, i = 0; i < scode.cnt; i++) {
+    fprintf(fp, " %d,", off);
+    off += scode.slen[i] + 1;
+  }
+  fprintf(fp, " %d\n};\n\n", off);
+
+  fprintf(fp, "const char def_sval[] PROGMEM =");
+  for (i = 0; i < scode.cnt; i++) {
+    memcpy(val, scode.sarena + scode.soff[i], scode.slen[i]);
+    val[scode.slen[i]] = 0;
+    fprintf(fp, "\n  ");
+    put_cstr(fp, val);
+    fprintf(fp, " \"\\0\"");
+  }
+  fprintf(fp, "%s;\n\n", scode.cnt ? "" : " \"\"");
+
+  // slot = index + 1 of the code, see skhash
+  fprintf(fp, "const uint16_t def_shash[1 << DEF_SHASHBITS] PROGMEM = {");
+  for (i = 0; i <= mask; i++)
+    fprintf(fp, "%s%d,", i % 16 ? " " : "\n  ", hash[i]);
+  fprintf(fp, "\n};\n\n#endif\n");
+  fclose(fp);
+  free(hash);
+
+  printf("%s: %d morse codes, %d short codes, %d bytes of phrases -> %s\n",
+         src, mcode.cnt, scode.cnt, off, fn);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  mcodes mcode;
+  scodes scode;
+  pcodes pcode;
+  gestures gest;
+  CodeBinHdr h;
+  char str[100];
+  char *p;
+  char *ptr[BINSECTS];
+  int len[BINSECTS];
+  const char *out;
+  uint32_t srcsize = 0, srccrc = 0, pos;
+  scount sc;
+  int i, n;
+  int hdr = 0;
+
+  if (argc > 1 && !strcmp(argv[1], "-h")) {
+    hdr = 1;
+    argv++;
+    argc--;
+  }
+  if (argc < 2) {
+    fprintf(stderr, "usage: m2gc [-h] CODE.CSV [CODE.BIN | m2g_codes.h]\n");
+    return 2;
+  }
+  out = argc > 2 ? argv[2] : (hdr ? "m2g_codes.h" : CODEBIN);
+
+  FILE *fp = fopen(argv[1], "rb");
+  if (!fp) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  // size and CRC of CODE.CSV
+  while ((n = fread(str, 1, BINBLOCK, fp)) > 0) {
+    srccrc = crc32_update(srccrc, (unsigned char *)str, n);
+    sc.add(str, n);
+    srcsize += n;
+  }
+  sc.done();
+  rewind(fp);
+  scode.reserve(sc.lines, sc.bytes, hdr ? 0 : SCODESD);  // headers need the values
+
+  // same dispatch as ReadDataFile
+  while (pos = ftell(fp), csv_fgets(str, 100, fp) != NULL) {
+    if ((p = strchr(str, '\n')) != NULL)
+      * p = '\0';
+    if (hdr && (p = strchr(str, '\r')) != NULL)  // CRLF files
+      * p = '\0';
+
+    switch (str[0]) {
+      case 'm':
+        mcode.loadcode(str);
+        break;
+      case 's':
+        if (scode.loadcode(str, pos) < 0) {
+          fprintf(stderr, "short code not loaded: %s\n", str);
+          return 1;
+        }
+        break;
+      case 'p':
+        pcode.loadcode(str);
+        break;
+      case 'g':
+        if (gest.loadcode(str) < 0) {
+          fprintf(stderr, "gesture code not loaded: %s\n", str);
+          return 1;
+        }
+        break;
+    }
+  }
+  fclose(fp);
+  scode.sortcode();
+
+  if (hdr)
+    return write_header(out, argv[1], mcode, scode);
+
+  memset(&h, 0, sizeof(h));
+  h.magic = BINMAGIC;
+  h.version = BINVERSION;
+  h.srcsize = srcsize;
+  h.srccrc = srccrc;
+  h.mcnt = mcode.cnt;
+  h.scnt = scode.cnt;
+  h.pvc = pcode.pvc;
+  h.sbytes = scode.aused;
+  h.flags = scode.sd ? BINSD : 0;
+
+  fp = fopen(out, "wb");
+  if (!fp) {
+    perror(out);
+    return 1;
+  }
+  fwrite(&h, sizeof(h), 1, fp);
+  n = codebin_map(h, mcode, scode, gest, ptr, len);
+  for (i = 0; i < n; i++)
+    fwrite(ptr[i], 1, len[i], fp);
+  fclose(fp);
+
+  printf("%s: %d morse codes, %d short codes, crc %08lx -> %s\n", argv[1],
+         mcode.cnt, scode.cnt, (unsigned long) srccrc, out);
+  return 0;
+}
@@ -0,0 +1,167 @@
+/* mbench.cpp -- times the morse code lookup, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative
+Commons Attribution-ShareAlike 4.0 International License. For more information
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/
+-- Basically, you can use this software for any purpose for free,
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line.
+
+Looks up the built-in morse codes (as many as the 52 that 2.2 could hold)
+over and over, two ways:
+  - as Release 2.2 did: the dits and dahs make a decimal key (2111 for B),
+    found by binary search in the keys sorted by q_sort
+  - as mdecoder and mcodes do now: the packed code is built a dit or dah at
+    a time as they are entered, and indexes mtab directly
+and checks that both find the same letter for each code.
+
+  build:  g++ -O2 -o mbench tools/mbench.cpp      (from the m2g_22 directory)
+  usage:  mbench
+
+The times are of the PC, not the Mega; what counts is how they compare.
+*/
+
+#include "../m2g.cpp"
+
+#include <stdlib.h>
+#include <time.h>
+
+#define ROUNDS 2000000L
+#define OLDCODES 52  // MAXMCODES in 2.2
+
+// ----------- the 2.2 lookup ---------------
+static long okey[OLDCODES];
+static char oval[OLDCODES];
+static int ocnt;
+
+static void q_sort(long *mkeys, char *mvals, int left, int right) {
+  long pivot, l_hold, r_hold;
+  char pivot_v;
+
+  l_hold = left;
+  r_hold = right;
+  pivot = mkeys[left];
+  pivot_v = mvals[left];
+  while (left < right) {
+    while ((mkeys[right] >= pivot) && (left < right))
+      right--;
+    if (left != right) {
+      mkeys[left] = mkeys[right];
+      mvals[left] = mvals[right];
+      left++;
+    }
+    while ((mkeys[left] <= pivot) && (left < right))
+      left++;
+    if (left != right) {
+      mkeys[right] = mkeys[left];
+      mvals[right] = mvals[left];
+      right--;
+    }
+  }
+  mkeys[left] = pivot;
+  mvals[left] = pivot_v;
+  pivot = left;
+  left = l_hold;
+  right = r_hold;
+  if (left < pivot)
+    q_sort(mkeys, mvals, left, pivot - 1);
+  if (right > pivot)
+    q_sort(mkeys, mvals, pivot + 1, right);
+}
+
+static int oldgetcode(long key, char *val) {
+  int low = 0, high = ocnt - 1, mid;
+
+  while (low <= high) {
+    mid = (low + high) / 2;
+    if (okey[mid] < key)
+      low = mid + 1;
+    else if (okey[mid] == key) {
+      *val = oval[mid];
+      return 0;
+    }
+    else
+      high = mid - 1;
+  }
+  *val = '?';
+  return -1;
+}
+
+// char_stk::get_charval of 2.2
+static long oldcharval(int *ditdah, int n) {
+  long mult = 1, ch = 0;
+  int k;
+
+  for (k = n - 1; k > -1; k--) {
+    ch += ditdah[k] * mult;
+    mult *= 10;
+  }
+  return ch;
+}
+
+static double secs() {
+  return (double) clock() / CLOCKS_PER_SEC;
+}
+
+int main() {
+  static int dd[MTABSZ][MAXDD];  // dits (1) and dahs (2) of each code
+  static int len[MTABSZ];
+  static int code[MTABSZ];
+  mcodes mc;
+  mdecoder dec;
+  double t0, t1, t2;
+  long r, key;
+  unsigned sum1 = 0, sum2 = 0;
+  int n = 0, i, k, c, bad = 0;
+  char v1, v2;
+
+  // every built-in code, as its dits and dahs
+  for (c = 2; c < MTABSZ && n < OLDCODES; c++) {
+    if (!mc.val(c))
+      continue;
+    for (k = 0; c >> (k + 1); k++)
+      ;
+    len[n] = k;
+    for (i = 0; i < k; i++)
+      dd[n][i] = ((c >> (k - 1 - i)) & 1) + 1;
+    code[n] = c;
+    okey[ocnt] = oldcharval(dd[n], k);
+    oval[ocnt++] = mc.val(c);
+    n++;
+  }
+  q_sort(okey, oval, 0, ocnt - 1);
+
+  for (i = 0; i < n; i++) {
+    oldgetcode(oldcharval(dd[i], len[i]), &v1);
+    for (dec.clear(), k = 0; k < len[i]; k++)
+      dec.push(dd[i][k]);
+    dec.match(mc, &v2);
+    if (v1 != v2 || dec.cur != code[i])
+      bad++;
+  }
+
+  t0 = secs();
+  for (r = 0; r < ROUNDS; r++) {
+    i = r % n;
+    key = oldcharval(dd[i], len[i]);
+    oldgetcode(key, &v1);
+    sum1 += v1;
+  }
+  t1 = secs();
+  for (r = 0; r < ROUNDS; r++) {
+    i = r % n;
+    for (dec.clear(), k = 0; k < len[i]; k++)
+      dec.push(dd[i][k]);
+    dec.match(mc, &v2);
+    sum2 += v2;
+  }
+  t2 = secs();
+
+  printf("%d codes, %ld lookups each\n", n, ROUNDS);
+  printf("decimal key + binary search: %6.1f ns a letter\n", (t1 - t0) * 1e9 / ROUNDS);
+  printf("packed code + mtab:          %6.1f ns a letter\n", (t2 - t1) * 1e9 / ROUNDS);
+  printf("RAM on the Mega: %d bytes before, %d now\n", OLDCODES * (4 + 1), MTABSZ + MTABSZ / 8);
+  printf(bad || sum1 != sum2 ? "%d codes differ\n" : "same letters\n", bad);
+  return bad || sum1 != sum2;
+}
@@ -0,0 +1,126 @@
+/* sbench.cpp -- times the short code lookup, run on a PC
+ * see morse2go.org for more into
+ *
+This work is licensed 2014 by Jim Wroten ( www.jimwroten.com ) under a Creative
+Commons Attribution-ShareAlike 4.0 International License. For more information
+about this license, see www.creativecommons.org/licenses/by-sa/4.0/
+-- Basically, you can use this software for any purpose for free,
+as long as you say where you got it and that if you modify it, you don't remove
+any lines above THIS line.
+
+Loads 40, 400 and 4000 made up short codes and looks each of them up, over
+and over, two ways:
+  - as Release 2.2 did: strcmp against each key in turn
+  - through scodes, the sketch's own class from m2g.cpp: the hash of the
+    2 char key, with the codes loaded and indexed as the sketch does
+and checks that both find the same phrase for each key.
+
+  build:  g++ -O2 -o sbench tools/sbench.cpp      (from the m2g_22 directory)
+  usage:  sbench
+
+The times are of the PC, not the Mega; what counts is how they compare.
+*/
+
+#include "../m2g.cpp"
+
+#include <stdlib.h>
+#include <time.h>
+
+#define ROUNDS 1000000L
+#define MAXN 4000
+
+// ----------- the 2.2 lookup ---------------
+static char okey[MAXN][10];
+static char oval[MAXN][MAXSCODE_TXT];
+static int ocnt;
+
+static int oldgetcode(char *k, char *v) {
+  int i;
+
+  for (i = 0; i < ocnt; i++) {
+    if (strcmp(k, okey[i]) == 0) {
+      strcpy(v, oval[i]);
+      return strlen(v);
+    }
+  }
+  strcpy(v, "?");
+  return -1;
+}
+
+// chars a key can have: printable, not lowercase (loadcode makes keys
+// uppercase) and not the comma between the fields of CODE.CSV
+static char keychar(int i) {
+  int c;
+
+  for (c = '!'; c <= '~'; c++)
+    if (c != ',' && !islower(c) && i-- == 0)
+      return c;
+  return 0;
+}
+
+static double secs() {
+  return (double) clock() / CLOCKS_PER_SEC;
+}
+
+int main() {
+  static const int sizes[] = {40, 400, 4000};
+  char line[100], key[3], v1[MAXSCODE_TXT], v2[MAXSCODE_TXT];
+  double t0, t1, t2;
+  long r;
+  int s, n, i, bad = 0;
+  unsigned sum1, sum2;
+  uint32_t bytes;
+  scodes sc;
+
+  for (s = 0; s < 3; s++) {
+    n = sizes[s];
+    // short phrases, so 4000 codes still fit in the SCMAXMEM block
+    for (bytes = 0, ocnt = 0; ocnt < n; ocnt++) {
+      sprintf(okey[ocnt], "%c%c", keychar(ocnt / 67), keychar(ocnt % 67));
+      bytes += sprintf(oval[ocnt], "p%d", ocnt);
+    }
+    if (sc.reserve(n, bytes, 0) < 0) {
+      printf("no room for %d codes\n", n);
+      return 1;
+    }
+    for (ocnt = 0; ocnt < n; ocnt++) {
+      sprintf(line, "scode,:%s,%s", okey[ocnt], oval[ocnt]);
+      if (sc.loadcode(line, 0) < 0) {
+        printf("no room for code %d\n", ocnt);
+        return 1;
+      }
+    }
+    sc.sortcode();
+
+    sum1 = sum2 = 0;
+    t0 = secs();
+    for (r = 0; r < ROUNDS; r++) {
+      i = (r * 7919) % n;
+      oldgetcode(okey[i], v1);
+      sum1 += v1[1];
+    }
+    t1 = secs();
+    for (r = 0; r < ROUNDS; r++) {
+      i = (r * 7919) % n;
+      strcpy(key, okey[i]);
+      sc.getcode(key, v2);
+      sum2 += v2[1];
+    }
+    t2 = secs();
+
+    for (i = 0; i < n; i++) {
+      oldgetcode(okey[i], v1);
+      strcpy(key, okey[i]);
+      sc.getcode(key, v2);
+      if (strcmp(v1, v2))
+        bad++;
+    }
+    printf("%4d codes: strcmp in turn %8.1f ns, hash %5.1f ns a lookup\n",
+           n, (t1 - t0) * 1e9 / ROUNDS, (t2 - t1) * 1e9 / ROUNDS);
+    if (sum1 != sum2)
+      bad++;
+  }
+  sc.clear();
+  printf(bad ? "%d phrases differ\n" : "same phrases\n", bad);
+  return bad != 0;
+}